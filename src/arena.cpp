@@ -0,0 +1,60 @@
+#include "arena.h"
+
+#include <cstdint>
+
+namespace runtime {
+
+namespace {
+thread_local Arena* current_arena = nullptr;
+}  // namespace
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size)
+{ /* do nothing */ }
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+    // Объект, не помещающийся в блок обычного размера, получает собственный блок,
+    // а выделение продолжается из свободной части текущего блока
+    if (size + alignment > block_size_) {
+        std::byte* block = AddBlock(size + alignment);
+        const auto address = reinterpret_cast<std::uintptr_t>(block);
+        allocated_bytes_ += size;
+        return block + (alignment - address % alignment) % alignment;
+    }
+
+    auto address = reinterpret_cast<std::uintptr_t>(current_);
+    size_t padding = (alignment - address % alignment) % alignment;
+    if (current_ == nullptr || padding + size > remaining_) {
+        current_ = AddBlock(block_size_);
+        remaining_ = block_size_;
+        address = reinterpret_cast<std::uintptr_t>(current_);
+        padding = (alignment - address % alignment) % alignment;
+    }
+
+    void* result = current_ + padding;
+    current_ += padding + size;
+    remaining_ -= padding + size;
+    allocated_bytes_ += size;
+    return result;
+}
+
+std::byte* Arena::AddBlock(size_t size) {
+    // Память блока не заполняется нулями: её заполняют размещаемые объекты
+    blocks_.push_back(std::unique_ptr<std::byte[]>(new std::byte[size]));
+    return blocks_.back().get();
+}
+
+Arena* Arena::GetCurrent() {
+    return current_arena;
+}
+
+ArenaScope::ArenaScope(Arena* arena)
+    : prev_(current_arena) {
+    current_arena = arena;
+}
+
+ArenaScope::~ArenaScope() {
+    current_arena = prev_;
+}
+
+}  // namespace runtime
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace runtime {
+
+/*
+ * Арена: выделяет память последовательно из крупных блоков и возвращает блоки в кучу
+ * при своём разрушении. Объекты, размещённые в арене, располагаются в памяти рядом друг
+ * с другом, а к куче арена обращается лишь при добавлении блока. Деструкторы объектов
+ * арена не вызывает: объекты разрушают их владельцы, а память разрушенного объекта
+ * остаётся в блоке
+ */
+class Arena {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Выделяет size байт с выравниванием alignment
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Возвращает суммарный размер выделенной памяти
+    [[nodiscard]] size_t GetAllocatedBytes() const {
+        return allocated_bytes_;
+    }
+
+    // Возвращает количество блоков, полученных ареной
+    [[nodiscard]] size_t GetBlockCount() const {
+        return blocks_.size();
+    }
+
+    // Возвращает арену, установленную ArenaScope в текущем потоке, либо nullptr
+    [[nodiscard]] static Arena* GetCurrent();
+
+private:
+    // Добавляет блок размера size и возвращает его начало
+    std::byte* AddBlock(size_t size);
+
+    size_t block_size_;
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::byte* current_ = nullptr; // Начало свободной части текущего блока
+    size_t remaining_ = 0;         // Размер свободной части текущего блока
+    size_t allocated_bytes_ = 0;
+};
+
+// Делает арену текущей для своего потока на время своего существования
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena* arena);
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    ~ArenaScope();
+
+private:
+    Arena* prev_;
+};
+
+}  // namespace runtime
@@ -0,0 +1,184 @@
+#include "bytecode.h"
+
+#include <limits>
+
+using namespace std;
+
+namespace bytecode {
+
+using runtime::Executable;
+
+Chunk Compiler::Compile(const Executable& program) {
+    return Compile(flat::Builder::Build(program));
+}
+
+Chunk Compiler::Compile(const flat::Tree& tree) {
+    Compiler compiler(tree);
+    compiler.CompileNode(tree.root);
+    compiler.Emit(OpCode::Return);
+    return std::move(compiler.chunk_);
+}
+
+Chunk Compiler::CompileMethod(const runtime::Method& method) {
+    method.Prepare();
+    return Compile(*method.body);
+}
+
+Compiler::Compiler(const flat::Tree& tree)
+    : tree_(tree) {
+    chunk_.constants = tree.constants;
+    chunk_.names = tree.names;
+    chunk_.classes = tree.classes;
+    chunk_.nodes = tree.foreign;
+    chunk_.call_sites = tree.call_sites;
+    chunk_.field_sites = tree.field_sites;
+}
+
+void Compiler::CompileNode(uint32_t index) {
+    using flat::NodeKind;
+
+    const flat::Node& node = tree_.nodes[index];
+    switch (node.kind) {
+    case NodeKind::Const:
+        Emit(OpCode::LoadConst, node.a);
+        break;
+    case NodeKind::None:
+        Emit(OpCode::LoadNone);
+        break;
+    case NodeKind::LoadName:
+        Emit(OpCode::LoadName, node.a);
+        break;
+    case NodeKind::LoadSlot:
+        if (node.b > numeric_limits<uint16_t>::max()) {
+            throw runtime_error("Too many names in compiled fragment"s);
+        }
+        Emit(OpCode::LoadSlot, node.a, static_cast<uint16_t>(node.b));
+        break;
+    case NodeKind::LoadField:
+        CompileChildren(node);
+        Emit(OpCode::LoadField, node.a);
+        break;
+    case NodeKind::StoreName:
+        CompileChildren(node);
+        Emit(OpCode::StoreName, node.a);
+        break;
+    case NodeKind::StoreSlot:
+        CompileChildren(node);
+        Emit(OpCode::StoreSlot, node.a);
+        break;
+    case NodeKind::StoreField:
+        CompileChildren(node);
+        Emit(OpCode::StoreField, node.a);
+        break;
+    case NodeKind::Print:
+        for (size_t i = 0; i < node.child_count; ++i) {
+            CompileNode(tree_.GetChild(node, i));
+            Emit(OpCode::PrintValue, i == 0 ? 0 : 1);
+        }
+        Emit(OpCode::PrintNewline);
+        break;
+    case NodeKind::CallMethod:
+        CompileChildren(node);
+        Emit(OpCode::CallMethod, node.a, static_cast<uint16_t>(node.child_count - 1));
+        break;
+    case NodeKind::NewInstance:
+        CompileChildren(node);
+        Emit(OpCode::NewInstance, node.a, node.child_count);
+        break;
+    case NodeKind::Stringify:
+        CompileChildren(node);
+        Emit(OpCode::Stringify);
+        break;
+    case NodeKind::Add:
+        CompileChildren(node);
+        Emit(OpCode::Add);
+        break;
+    case NodeKind::Sub:
+        CompileChildren(node);
+        Emit(OpCode::Sub);
+        break;
+    case NodeKind::Mult:
+        CompileChildren(node);
+        Emit(OpCode::Mult);
+        break;
+    case NodeKind::Div:
+        CompileChildren(node);
+        Emit(OpCode::Div);
+        break;
+    case NodeKind::And:
+        CompileLogical(node, OpCode::JumpIfFalseOrPop);
+        break;
+    case NodeKind::Or:
+        CompileLogical(node, OpCode::JumpIfTrueOrPop);
+        break;
+    case NodeKind::Not:
+        CompileChildren(node);
+        Emit(OpCode::Not);
+        break;
+    case NodeKind::Compare:
+        CompileChildren(node);
+        Emit(OpCode::Compare, node.a);
+        break;
+    case NodeKind::Compound:
+        for (size_t i = 0; i < node.child_count; ++i) {
+            CompileNode(tree_.GetChild(node, i));
+            Emit(OpCode::Pop);
+        }
+        Emit(OpCode::LoadNone);
+        break;
+    case NodeKind::MethodBody:
+    case NodeKind::Return:
+        CompileChildren(node);
+        Emit(OpCode::Return);
+        // Недостижимое значение сохраняет инвариант "одно значение на узел"
+        Emit(OpCode::LoadNone);
+        break;
+    case NodeKind::DefineClass:
+        Emit(OpCode::DefineClass, node.a);
+        break;
+    case NodeKind::IfElse: {
+        CompileNode(tree_.GetChild(node, 0));
+        const size_t jump_to_else = Emit(OpCode::JumpIfFalse);
+        CompileNode(tree_.GetChild(node, 1));
+        const size_t jump_to_end = Emit(OpCode::Jump);
+        PatchJump(jump_to_else);
+        if (node.child_count > 2) {
+            CompileNode(tree_.GetChild(node, 2));
+        }
+        else {
+            Emit(OpCode::LoadNone);
+        }
+        PatchJump(jump_to_end);
+        break;
+    }
+    case NodeKind::Foreign:
+        Emit(OpCode::ExecAst, node.a);
+        break;
+    }
+}
+
+void Compiler::CompileChildren(const flat::Node& node) {
+    for (size_t i = 0; i < node.child_count; ++i) {
+        CompileNode(tree_.GetChild(node, i));
+    }
+}
+
+void Compiler::CompileLogical(const flat::Node& node, OpCode short_circuit_jump) {
+    CompileNode(tree_.GetChild(node, 0));
+    Emit(OpCode::ToBool);
+    const size_t jump_to_end = Emit(short_circuit_jump);
+    CompileNode(tree_.GetChild(node, 1));
+    Emit(OpCode::ToBool);
+    PatchJump(jump_to_end);
+}
+
+size_t Compiler::Emit(OpCode op, uint32_t a, uint16_t b) {
+    chunk_.code.push_back(Instruction{op, b, a});
+    return chunk_.code.size() - 1;
+}
+
+void Compiler::PatchJump(size_t jump_pos) {
+    chunk_.code[jump_pos].a = static_cast<uint32_t>(chunk_.code.size());
+}
+
+}  // namespace bytecode
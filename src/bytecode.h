@@ -0,0 +1,101 @@
+#pragma once
+
+#include "flat_ast.h"
+#include "runtime.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bytecode {
+
+// Коды инструкций стековой виртуальной машины.
+// В комментариях указано назначение аргументов a и b и изменение стека
+enum class OpCode : std::uint8_t {
+    LoadConst,     // a - индекс константы; -> value
+    LoadNone,      // -> None
+    LoadName,      // a - индекс имени; -> value
+    StoreName,     // a - индекс имени; value -> value
+    LoadSlot,      // a - слот кадра метода, b - индекс имени; -> value
+    StoreSlot,     // a - слот кадра метода; value -> value
+    LoadField,     // a - индекс места доступа к полю; object -> value
+    StoreField,    // a - индекс места доступа к полю; object value -> value
+    Pop,           // value ->
+    PrintValue,    // a - 1, если перед значением выводится пробел; value ->
+    PrintNewline,  // -> None
+    Stringify,     // value -> string
+    Add,           // lhs rhs -> result
+    Sub,           // lhs rhs -> result
+    Mult,          // lhs rhs -> result
+    Div,           // lhs rhs -> result
+    ToBool,        // value -> bool (операнд логической операции, не может быть None)
+    Not,           // value -> bool
+    Compare,       // a - вид сравнения (runtime::Comparator); lhs rhs -> bool
+    Jump,          // a - адрес перехода
+    JumpIfFalse,   // a - адрес перехода; condition ->
+    JumpIfFalseOrPop, // a - адрес перехода; bool -> bool, если False, иначе bool ->
+    JumpIfTrueOrPop,  // a - адрес перехода; bool -> bool, если True, иначе bool ->
+    CallMethod,    // a - индекс места вызова, b - число аргументов; object args... -> result
+    NewInstance,   // a - индекс класса, b - число аргументов; args... -> instance
+    DefineClass,   // a - индекс константы с классом; -> class
+    ExecAst,       // a - индекс узла AST, исполняемого интерпретатором дерева; -> result
+    Return,        // value -> (завершает выполнение фрагмента)
+};
+
+// Инструкция виртуальной машины
+struct Instruction {
+    OpCode op;
+    std::uint16_t b = 0;
+    std::uint32_t a = 0;
+};
+
+using flat::CallSite;
+using flat::FieldSite;
+
+// Скомпилированный фрагмент кода: тело программы либо тело метода
+struct Chunk {
+    std::vector<Instruction> code;                 // Последовательность инструкций
+    std::vector<runtime::ObjectHolder> constants;  // Таблица констант
+    std::vector<runtime::Symbol> names;            // Имена переменных, полей и методов
+    std::vector<const runtime::Class*> classes;    // Классы для инструкции NewInstance
+    std::vector<const runtime::Executable*> nodes; // Узлы, исполняемые без компиляции
+    std::vector<CallSite> call_sites;              // Места вызова методов
+    std::vector<FieldSite> field_sites;            // Места доступа к полям
+};
+
+// Компилятор плоского AST в линейный байткод
+class Compiler {
+public:
+    // Компилирует программу, построенную ParseProgram. Результат фрагмента - значение,
+    // которое вернул бы program.Execute
+    [[nodiscard]] static Chunk Compile(const runtime::Executable& program);
+
+    // Компилирует плоское AST. Таблицы констант, имён, классов и мест доступа
+    // переносятся во фрагмент без изменения индексов
+    [[nodiscard]] static Chunk Compile(const flat::Tree& tree);
+
+    // Компилирует тело метода method. Результат фрагмента - значение, которое вернул бы
+    // вызов метода
+    [[nodiscard]] static Chunk CompileMethod(const runtime::Method& method);
+
+private:
+    explicit Compiler(const flat::Tree& tree);
+
+    // Генерирует код, оставляющий на стеке ровно одно значение - результат узла index
+    void CompileNode(std::uint32_t index);
+    // Генерирует код для дочерних узлов node в порядке их следования
+    void CompileChildren(const flat::Node& node);
+    // Генерирует код логической операции and либо or. Правый операнд пропускается
+    // инструкцией short_circuit_jump, если результат определяется левым операндом
+    void CompileLogical(const flat::Node& node, OpCode short_circuit_jump);
+
+    // Добавляет инструкцию и возвращает её адрес
+    size_t Emit(OpCode op, std::uint32_t a = 0, std::uint16_t b = 0);
+    // Записывает в инструкцию перехода по адресу jump_pos адрес следующей инструкции
+    void PatchJump(size_t jump_pos);
+
+    const flat::Tree& tree_;
+    Chunk chunk_;
+};
+
+}  // namespace bytecode
@@ -0,0 +1,202 @@
+#include "flat_ast.h"
+
+#include "statement.h"
+
+#include <limits>
+
+using namespace std;
+
+namespace flat {
+
+using runtime::Executable;
+using runtime::ObjectHolder;
+
+Tree Builder::Build(const Executable& program) {
+    Builder builder;
+    builder.tree_.root = builder.AddNode(program);
+    return std::move(builder.tree_);
+}
+
+uint32_t Builder::AddNode(const Executable& node) {
+    if (const auto* num = dynamic_cast<const ast::NumericConst*>(&node)) {
+        return AddNode(NodeKind::Const, {},
+                       AddConstant(ObjectHolder::Own(runtime::Number(num->GetValue()))));
+    }
+    if (const auto* str = dynamic_cast<const ast::StringConst*>(&node)) {
+        return AddNode(NodeKind::Const, {},
+                       AddConstant(ObjectHolder::Own(runtime::String(str->GetValue()))));
+    }
+    if (const auto* bool_const = dynamic_cast<const ast::BoolConst*>(&node)) {
+        return AddNode(NodeKind::Const, {},
+                       AddConstant(ObjectHolder::Own(runtime::Bool(bool_const->GetValue()))));
+    }
+    if (dynamic_cast<const ast::None*>(&node)) {
+        return AddNode(NodeKind::None, {});
+    }
+    if (const auto* var = dynamic_cast<const ast::VariableValue*>(&node)) {
+        return AddVariable(*var);
+    }
+    if (const auto* assign = dynamic_cast<const ast::Assignment*>(&node)) {
+        const uint32_t value = AddNode(assign->GetRvalue());
+        if (assign->GetSlot()) {
+            return AddNode(NodeKind::StoreSlot, {value}, static_cast<uint32_t>(*assign->GetSlot()));
+        }
+        return AddNode(NodeKind::StoreName, {value}, AddName(assign->GetVarName()));
+    }
+    if (const auto* field_assign = dynamic_cast<const ast::FieldAssignment*>(&node)) {
+        const uint32_t object = AddVariable(field_assign->GetObject());
+        const uint32_t value = AddNode(field_assign->GetRvalue());
+        return AddNode(NodeKind::StoreField, {object, value},
+                       AddFieldSite(field_assign->GetFieldName()));
+    }
+    if (const auto* print = dynamic_cast<const ast::Print*>(&node)) {
+        vector<uint32_t> args;
+        for (const auto& arg : print->GetArgs()) {
+            args.push_back(AddNode(*arg));
+        }
+        return AddNode(NodeKind::Print, args);
+    }
+    if (const auto* call = dynamic_cast<const ast::MethodCall*>(&node)) {
+        vector<uint32_t> children{AddNode(call->GetObject())};
+        for (const auto& arg : call->GetArgs()) {
+            children.push_back(AddNode(*arg));
+        }
+        return AddNode(NodeKind::CallMethod, children, AddCallSite(call->GetMethodName()));
+    }
+    if (const auto* new_inst = dynamic_cast<const ast::NewInstance*>(&node)) {
+        vector<uint32_t> args;
+        for (const auto& arg : new_inst->GetArgs()) {
+            args.push_back(AddNode(*arg));
+        }
+        return AddNode(NodeKind::NewInstance, args, AddClass(new_inst->GetClass()));
+    }
+    if (const auto* stringify = dynamic_cast<const ast::Stringify*>(&node)) {
+        return AddNode(NodeKind::Stringify, {AddNode(stringify->GetArgument())});
+    }
+    if (const auto* not_op = dynamic_cast<const ast::Not*>(&node)) {
+        return AddNode(NodeKind::Not, {AddNode(not_op->GetArgument())});
+    }
+    if (const auto* binary = dynamic_cast<const ast::BinaryOperation*>(&node)) {
+        NodeKind kind;
+        uint32_t a = 0;
+        if (const auto* comparison = dynamic_cast<const ast::Comparison*>(&node)) {
+            kind = NodeKind::Compare;
+            a = static_cast<uint32_t>(comparison->GetComparator());
+        }
+        else if (dynamic_cast<const ast::Add*>(&node)) {
+            kind = NodeKind::Add;
+        }
+        else if (dynamic_cast<const ast::Sub*>(&node)) {
+            kind = NodeKind::Sub;
+        }
+        else if (dynamic_cast<const ast::Mult*>(&node)) {
+            kind = NodeKind::Mult;
+        }
+        else if (dynamic_cast<const ast::Div*>(&node)) {
+            kind = NodeKind::Div;
+        }
+        else if (dynamic_cast<const ast::And*>(&node)) {
+            kind = NodeKind::And;
+        }
+        else if (dynamic_cast<const ast::Or*>(&node)) {
+            kind = NodeKind::Or;
+        }
+        else {
+            return AddForeign(node);
+        }
+        const uint32_t lhs = AddNode(binary->GetLhs());
+        const uint32_t rhs = AddNode(binary->GetRhs());
+        return AddNode(kind, {lhs, rhs}, a);
+    }
+    if (const auto* compound = dynamic_cast<const ast::Compound*>(&node)) {
+        vector<uint32_t> statements;
+        for (const auto& stmt : compound->GetStatements()) {
+            statements.push_back(AddNode(*stmt));
+        }
+        return AddNode(NodeKind::Compound, statements);
+    }
+    if (const auto* method_body = dynamic_cast<const ast::MethodBody*>(&node)) {
+        return AddNode(NodeKind::MethodBody, {AddNode(method_body->GetBody())});
+    }
+    if (const auto* ret = dynamic_cast<const ast::Return*>(&node)) {
+        return AddNode(NodeKind::Return, {AddNode(ret->GetStatement())});
+    }
+    if (const auto* program = dynamic_cast<const ast::Program*>(&node)) {
+        return AddNode(program->GetRoot());
+    }
+    if (const auto* class_def = dynamic_cast<const ast::ClassDefinition*>(&node)) {
+        return AddNode(NodeKind::DefineClass, {}, AddConstant(class_def->GetClass()));
+    }
+    if (const auto* if_else = dynamic_cast<const ast::IfElse*>(&node)) {
+        vector<uint32_t> children{AddNode(if_else->GetCondition()),
+                                  AddNode(if_else->GetIfBody())};
+        if (const Executable* else_body = if_else->GetElseBody()) {
+            children.push_back(AddNode(*else_body));
+        }
+        return AddNode(NodeKind::IfElse, children);
+    }
+
+    // Узлы неизвестных типов (например, тела методов, заданные в тестах)
+    // исполняются интерпретатором дерева
+    return AddForeign(node);
+}
+
+uint32_t Builder::AddNode(NodeKind kind, const vector<uint32_t>& children, uint32_t a, uint32_t b) {
+    if (children.size() > numeric_limits<uint16_t>::max()) {
+        throw runtime_error("Too many arguments in call"s);
+    }
+
+    Node node{kind, static_cast<uint16_t>(children.size()), a, b,
+              static_cast<uint32_t>(tree_.children.size())};
+    tree_.children.insert(tree_.children.end(), children.begin(), children.end());
+    tree_.nodes.push_back(node);
+    return static_cast<uint32_t>(tree_.nodes.size() - 1);
+}
+
+uint32_t Builder::AddVariable(const ast::VariableValue& var) {
+    const vector<runtime::Symbol>& ids = var.GetIds();
+    uint32_t result = var.GetSlot()
+        ? AddNode(NodeKind::LoadSlot, {}, static_cast<uint32_t>(*var.GetSlot()),
+                  AddName(ids.front()))
+        : AddNode(NodeKind::LoadName, {}, AddName(ids.front()));
+    for (size_t i = 1; i < ids.size(); ++i) {
+        result = AddNode(NodeKind::LoadField, {result}, AddFieldSite(ids[i]));
+    }
+    return result;
+}
+
+uint32_t Builder::AddForeign(const Executable& node) {
+    tree_.foreign.push_back(&node);
+    return AddNode(NodeKind::Foreign, {}, static_cast<uint32_t>(tree_.foreign.size() - 1));
+}
+
+uint32_t Builder::AddConstant(ObjectHolder value) {
+    tree_.constants.push_back(std::move(value));
+    return static_cast<uint32_t>(tree_.constants.size() - 1);
+}
+
+uint32_t Builder::AddName(runtime::Symbol name) {
+    auto [it, inserted] = name_indices_.emplace(name, static_cast<uint32_t>(tree_.names.size()));
+    if (inserted) {
+        tree_.names.push_back(name);
+    }
+    return it->second;
+}
+
+uint32_t Builder::AddClass(const runtime::Class& cls) {
+    tree_.classes.push_back(&cls);
+    return static_cast<uint32_t>(tree_.classes.size() - 1);
+}
+
+uint32_t Builder::AddCallSite(runtime::Symbol method_name) {
+    tree_.call_sites.push_back(
+        CallSite{AddName(method_name), runtime::InternMethodName(method_name), {}});
+    return static_cast<uint32_t>(tree_.call_sites.size() - 1);
+}
+
+uint32_t Builder::AddFieldSite(runtime::Symbol field_name) {
+    tree_.field_sites.push_back(FieldSite{AddName(field_name), {}});
+    return static_cast<uint32_t>(tree_.field_sites.size() - 1);
+}
+
+}  // namespace flat
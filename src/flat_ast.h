@@ -0,0 +1,119 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ast {
+class VariableValue;
+}  // namespace ast
+
+namespace flat {
+
+// Вид узла плоского AST.
+// В комментариях указано назначение полей a и b узла и его дочерние узлы
+enum class NodeKind : std::uint8_t {
+    Const,       // a - индекс константы
+    None,        // Значение None
+    LoadName,    // a - индекс имени глобальной переменной
+    LoadSlot,    // a - слот кадра метода, b - индекс имени переменной
+    LoadField,   // a - индекс места доступа к полю; [объект]
+    StoreName,   // a - индекс имени; [значение]
+    StoreSlot,   // a - слот кадра метода; [значение]
+    StoreField,  // a - индекс места доступа к полю; [объект, значение]
+    Print,       // [аргументы...]
+    CallMethod,  // a - индекс места вызова; [объект, аргументы...]
+    NewInstance, // a - индекс класса; [аргументы...]
+    Stringify,   // [аргумент]
+    Add,         // [lhs, rhs]
+    Sub,         // [lhs, rhs]
+    Mult,        // [lhs, rhs]
+    Div,         // [lhs, rhs]
+    And,         // [lhs, rhs]
+    Or,          // [lhs, rhs]
+    Not,         // [аргумент]
+    Compare,     // a - вид сравнения (runtime::Comparator); [lhs, rhs]
+    Compound,    // [инструкции...]
+    MethodBody,  // [тело]
+    Return,      // [выражение]
+    DefineClass, // a - индекс константы с классом
+    IfElse,      // [условие, ветка if] либо [условие, ветка if, ветка else]
+    Foreign,     // a - индекс узла AST, исполняемого интерпретатором дерева
+};
+
+// Узел плоского AST. Индексы дочерних узлов хранятся подряд в Tree::children,
+// начиная с позиции children
+struct Node {
+    NodeKind kind;
+    std::uint16_t child_count = 0;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    std::uint32_t children = 0;
+};
+
+// Место вызова метода со своим встроенным кэшем
+struct CallSite {
+    std::uint32_t name = 0;                  // Индекс имени метода
+    runtime::MethodId method_id = 0;         // Идентификатор имени метода
+    mutable runtime::MethodCache cache;      // Заполняется при исполнении
+};
+
+// Место доступа к полю объекта со своим кэшем смещения
+struct FieldSite {
+    std::uint32_t name = 0;                  // Индекс имени поля
+    mutable runtime::FieldCache cache;       // Заполняется при исполнении
+};
+
+/*
+ * Плоское представление AST: узлы хранятся подряд в одном векторе и ссылаются на дочерние
+ * узлы 32-битными индексами, а константы, имена и классы вынесены в отдельные таблицы.
+ * Обход такого дерева не разыменовывает указатели на разбросанные по куче узлы.
+ *
+ * Дерево ссылается на классы и узлы исходного AST, поэтому не должно его переживать
+ */
+struct Tree {
+    // Возвращает индекс i-го дочернего узла узла node
+    [[nodiscard]] std::uint32_t GetChild(const Node& node, size_t i) const {
+        return children[node.children + i];
+    }
+
+    std::uint32_t root = 0;                        // Индекс корневого узла
+    std::vector<Node> nodes;                       // Узлы; дочерние узлы предшествуют родителю
+    std::vector<std::uint32_t> children;           // Индексы дочерних узлов
+    std::vector<runtime::ObjectHolder> constants;  // Таблица констант
+    std::vector<runtime::Symbol> names;            // Имена переменных, полей и методов
+    std::vector<const runtime::Class*> classes;    // Классы для узлов NewInstance
+    std::vector<const runtime::Executable*> foreign; // Узлы, исполняемые без преобразования
+    std::vector<CallSite> call_sites;              // Места вызова методов
+    std::vector<FieldSite> field_sites;            // Места доступа к полям
+};
+
+// Строит плоское AST из дерева узлов, построенного ParseProgram
+class Builder {
+public:
+    // Преобразует program. Узлы неизвестных типов сохраняются как узлы Foreign
+    [[nodiscard]] static Tree Build(const runtime::Executable& program);
+
+private:
+    // Добавляет узел node и его потомков, возвращает индекс узла
+    std::uint32_t AddNode(const runtime::Executable& node);
+    // Добавляет узел вида kind с дочерними узлами children
+    std::uint32_t AddNode(NodeKind kind, const std::vector<std::uint32_t>& children,
+                          std::uint32_t a = 0, std::uint32_t b = 0);
+    // Добавляет узлы, загружающие значение цепочки id1.id2...idN
+    std::uint32_t AddVariable(const ast::VariableValue& var);
+    std::uint32_t AddForeign(const runtime::Executable& node);
+
+    std::uint32_t AddConstant(runtime::ObjectHolder value);
+    std::uint32_t AddName(runtime::Symbol name);
+    std::uint32_t AddClass(const runtime::Class& cls);
+    std::uint32_t AddCallSite(runtime::Symbol method_name);
+    std::uint32_t AddFieldSite(runtime::Symbol field_name);
+
+    Tree tree_;
+    std::unordered_map<runtime::Symbol, std::uint32_t> name_indices_;
+};
+
+}  // namespace flat
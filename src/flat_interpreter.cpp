@@ -0,0 +1,345 @@
+#include "flat_interpreter.h"
+
+#include "gc.h"
+
+using namespace std;
+
+namespace flat {
+
+using runtime::Closure;
+using runtime::ObjectHolder;
+
+namespace {
+const runtime::Symbol SELF{"self"sv};
+
+// Приводит операнд логической операции operation_name к bool.
+// Если значение операнда равно None - выбрасывает runtime_error
+bool GetLogicalOperand(const ObjectHolder& value, const char* operation_name) {
+    if (!value) {
+        throw runtime_error("Attemp to call operator "s + operation_name
+                            + " for wrong object types"s);
+    }
+    return IsTrue(value);
+}
+}  // namespace
+
+Interpreter::Interpreter(runtime::Context& context)
+    : context_(context)
+{ /* do nothing */ }
+
+auto Interpreter::CallWithoutArguments() {
+    return [this](runtime::ClassInstance& instance, const runtime::Method& method) {
+        return CallMethod(instance, method, [](size_t) {
+            return ObjectHolder();
+        });
+    };
+}
+
+ObjectHolder Interpreter::Run(const Tree& tree, Closure& closure) {
+    return Execute(tree, tree.root, closure);
+}
+
+ObjectHolder Interpreter::Execute(const Tree& tree, uint32_t index, Closure& closure) {
+    // Вызов метода Mython проходит через несколько вложенных вызовов Execute, поэтому узлы,
+    // вычисляющие дочерние узлы, исполняются отдельными методами. Execute лишь выбирает
+    // метод по виду узла, и его кадр в стеке остаётся малым
+    const Node& node = tree.nodes[index];
+    switch (node.kind) {
+    case NodeKind::Const:
+        return tree.constants[node.a];
+    case NodeKind::None:
+        return {};
+    case NodeKind::LoadName:
+    case NodeKind::LoadSlot:
+    case NodeKind::LoadField:
+        return Locate(tree, index, closure);
+    case NodeKind::StoreName:
+    case NodeKind::StoreSlot:
+        return ExecuteStore(tree, node, closure);
+    case NodeKind::StoreField:
+        return ExecuteStoreField(tree, node, closure);
+    case NodeKind::Print:
+        return ExecutePrint(tree, node, closure);
+    case NodeKind::CallMethod:
+        return ExecuteCallMethod(tree, node, closure);
+    case NodeKind::NewInstance:
+        return ExecuteNewInstance(tree, node, closure);
+    case NodeKind::Stringify:
+        return ExecuteStringify(tree, node, closure);
+    case NodeKind::Add:
+        return ExecuteAdd(tree, node, closure);
+    case NodeKind::Sub:
+        return ExecuteArithmetic(runtime::ArithmeticOperation::Sub, tree, node, closure);
+    case NodeKind::Mult:
+        return ExecuteArithmetic(runtime::ArithmeticOperation::Mult, tree, node, closure);
+    case NodeKind::Div:
+        return ExecuteArithmetic(runtime::ArithmeticOperation::Div, tree, node, closure);
+    case NodeKind::And:
+    case NodeKind::Or:
+    case NodeKind::Not:
+        return ExecuteLogical(tree, node, closure);
+    case NodeKind::Compare:
+        return ExecuteCompare(tree, node, closure);
+    case NodeKind::Compound:
+        return ExecuteCompound(tree, node, closure);
+    case NodeKind::MethodBody:
+    case NodeKind::Return:
+        return ExecuteReturn(tree, node, closure);
+    case NodeKind::DefineClass:
+        return ExecuteDefineClass(tree, node, closure);
+    case NodeKind::IfElse:
+        return ExecuteIfElse(tree, node, closure);
+    case NodeKind::Foreign:
+        return ExecuteForeign(tree, node, closure);
+    }
+    return {};
+}
+
+ObjectHolder Interpreter::ExecuteStore(const Tree& tree, const Node& node, Closure& closure) {
+    if (node.kind == NodeKind::StoreName) {
+        return closure[tree.names[node.a]] = Execute(tree, tree.GetChild(node, 0), closure);
+    }
+    return *((*context_.GetFrame())[node.a] = Execute(tree, tree.GetChild(node, 0), closure));
+}
+
+ObjectHolder Interpreter::ExecuteStoreField(const Tree& tree, const Node& node,
+                                            Closure& closure) {
+    const FieldSite& site = tree.field_sites[node.a];
+    ObjectHolder object = Execute(tree, tree.GetChild(node, 0), closure);
+    auto* instance = object.TryAs<runtime::ClassInstance>();
+    if (instance == nullptr) {
+        throw runtime_error("Attemp to assign field "s + tree.names[site.name]
+                            + " of non-object value"s);
+    }
+    return instance->SetField(tree.names[site.name], Execute(tree, tree.GetChild(node, 1), closure),
+                              site.cache);
+}
+
+ObjectHolder Interpreter::ExecutePrint(const Tree& tree, const Node& node, Closure& closure) {
+    auto& output = context_.GetOutputStream();
+    for (size_t i = 0; i < node.child_count; ++i) {
+        ObjectHolder value = Execute(tree, tree.GetChild(node, i), closure);
+        if (i > 0) {
+            output << ' ';
+        }
+        runtime::PrintValue(value, output, context_, CallWithoutArguments());
+    }
+    output << '\n';
+    return {};
+}
+
+ObjectHolder Interpreter::ExecuteCallMethod(const Tree& tree, const Node& node,
+                                            Closure& closure) {
+    ObjectHolder object = Execute(tree, tree.GetChild(node, 0), closure);
+    if (object.GetType() != runtime::ObjectType::ClassInstance) {
+        return {};
+    }
+    const CallSite& site = tree.call_sites[node.a];
+    auto* instance = static_cast<runtime::ClassInstance*>(object.Get());
+    const runtime::Method* method = site.cache.Lookup(instance->GetClass(), site.method_id);
+    if (method == nullptr || method->formal_params.size() + 1 != node.child_count) {
+        return {};
+    }
+    return CallMethod(*instance, *method, [&](size_t i) {
+        return Execute(tree, tree.GetChild(node, i + 1), closure);
+    });
+}
+
+ObjectHolder Interpreter::ExecuteNewInstance(const Tree& tree, const Node& node,
+                                             Closure& closure) {
+    runtime::GarbageCollector::AtSafePoint();
+    ObjectHolder instance = ObjectHolder::Own(runtime::ClassInstance(*tree.classes[node.a]));
+    auto* instance_ptr = static_cast<runtime::ClassInstance*>(instance.Get());
+    if (const runtime::Method* init = instance_ptr->GetSpecialMethod(
+            runtime::SpecialMethod::Init, node.child_count)) {
+        CallMethod(*instance_ptr, *init, [&](size_t i) {
+            return Execute(tree, tree.GetChild(node, i), closure);
+        });
+    }
+    return instance;
+}
+
+ObjectHolder Interpreter::ExecuteStringify(const Tree& tree, const Node& node,
+                                           Closure& closure) {
+    return runtime::Stringify(Execute(tree, tree.GetChild(node, 0), closure), context_,
+                              CallWithoutArguments());
+}
+
+ObjectHolder Interpreter::ExecuteAdd(const Tree& tree, const Node& node, Closure& closure) {
+    ObjectHolder lhs = Execute(tree, tree.GetChild(node, 0), closure);
+    ObjectHolder rhs = Execute(tree, tree.GetChild(node, 1), closure);
+    return Add(lhs, rhs);
+}
+
+ObjectHolder Interpreter::Add(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+    return runtime::Add(lhs, rhs, [this, &rhs](runtime::ClassInstance& instance,
+                                               const runtime::Method& method) {
+        return CallMethod(instance, method, [&rhs](size_t) {
+            return rhs;
+        });
+    });
+}
+
+ObjectHolder Interpreter::ExecuteArithmetic(runtime::ArithmeticOperation operation,
+                                            const Tree& tree, const Node& node,
+                                            Closure& closure) {
+    ObjectHolder lhs = Execute(tree, tree.GetChild(node, 0), closure);
+    return runtime::Arithmetic(operation, lhs, Execute(tree, tree.GetChild(node, 1), closure));
+}
+
+ObjectHolder Interpreter::ExecuteLogical(const Tree& tree, const Node& node, Closure& closure) {
+    auto operand = [&](size_t i, const char* operation_name) {
+        return GetLogicalOperand(Execute(tree, tree.GetChild(node, i), closure), operation_name);
+    };
+
+    bool result = false;
+    if (node.kind == NodeKind::And) {
+        result = operand(0, "And") && operand(1, "And");
+    }
+    else if (node.kind == NodeKind::Or) {
+        result = operand(0, "Or") || operand(1, "Or");
+    }
+    else {
+        ObjectHolder value = Execute(tree, tree.GetChild(node, 0), closure);
+        if (!value) {
+            throw runtime_error("Wrong argument parsed to Not"s);
+        }
+        result = !IsTrue(value);
+    }
+    return ObjectHolder::Own(runtime::Bool{result});
+}
+
+ObjectHolder Interpreter::ExecuteCompare(const Tree& tree, const Node& node, Closure& closure) {
+    ObjectHolder lhs = Execute(tree, tree.GetChild(node, 0), closure);
+    ObjectHolder rhs = Execute(tree, tree.GetChild(node, 1), closure);
+    return ObjectHolder::Own(runtime::Bool{runtime::Compare(
+        static_cast<runtime::Comparator>(node.a), lhs, rhs, context_)});
+}
+
+ObjectHolder Interpreter::ExecuteCompound(const Tree& tree, const Node& node, Closure& closure) {
+    for (size_t i = 0; i < node.child_count; ++i) {
+        ObjectHolder result = Execute(tree, tree.GetChild(node, i), closure);
+        // Результат return передаётся вверх до тела метода
+        if (context_.IsReturning()) {
+            return result;
+        }
+    }
+    return {};
+}
+
+ObjectHolder Interpreter::ExecuteReturn(const Tree& tree, const Node& node, Closure& closure) {
+    ObjectHolder result = Execute(tree, tree.GetChild(node, 0), closure);
+    // Return начинает возврат из метода, а тело метода его завершает
+    context_.SetReturning(node.kind == NodeKind::Return);
+    return result;
+}
+
+ObjectHolder Interpreter::ExecuteIfElse(const Tree& tree, const Node& node, Closure& closure) {
+    if (IsTrue(Execute(tree, tree.GetChild(node, 0), closure))) {
+        return Execute(tree, tree.GetChild(node, 1), closure);
+    }
+    if (node.child_count > 2) {
+        return Execute(tree, tree.GetChild(node, 2), closure);
+    }
+    return ObjectHolder::None();
+}
+
+ObjectHolder Interpreter::ExecuteDefineClass(const Tree& tree, const Node& node,
+                                             Closure& closure) {
+    const ObjectHolder& cls = tree.constants[node.a];
+    closure[cls.TryAs<runtime::Class>()->GetName()] = cls;
+    return cls;
+}
+
+ObjectHolder Interpreter::ExecuteForeign(const Tree& tree, const Node& node, Closure& closure) {
+    // Узлы AST не изменяются при исполнении, поэтому снятие const безопасно
+    return const_cast<runtime::Executable*>(tree.foreign[node.a])->Execute(closure, context_);
+}
+
+const ObjectHolder& Interpreter::Locate(const Tree& tree, uint32_t index, Closure& closure) {
+    const Node& node = tree.nodes[index];
+    switch (node.kind) {
+    case NodeKind::LoadName: {
+        auto it = closure.find(tree.names[node.a]);
+        if (it == closure.end()) {
+            throw runtime_error("Wrong var name: "s + tree.names[node.a]);
+        }
+        return it->second;
+    }
+    case NodeKind::LoadSlot: {
+        const optional<ObjectHolder>& value = (*context_.GetFrame())[node.a];
+        if (!value) {
+            throw runtime_error("Wrong var name: "s + tree.names[node.b]);
+        }
+        return *value;
+    }
+    default: {
+        const FieldSite& site = tree.field_sites[node.a];
+        const runtime::Symbol name = tree.names[site.name];
+        const ObjectHolder& object = Locate(tree, tree.GetChild(node, 0), closure);
+        if (object.GetType() != runtime::ObjectType::ClassInstance) {
+            throw runtime_error("Wrong var name: "s + name);
+        }
+        auto* instance = static_cast<runtime::ClassInstance*>(object.Get());
+        const ObjectHolder* field = instance->FindField(name, site.cache);
+        if (field == nullptr) {
+            throw runtime_error("Wrong var name: "s + name);
+        }
+        return *field;
+    }
+    }
+}
+
+const Tree& Interpreter::GetTree(const runtime::Method& method) {
+    unique_ptr<Tree>& body = method_trees_[&method];
+    if (!body) {
+        method.Prepare();
+        body = make_unique<Tree>(Builder::Build(*method.body));
+    }
+    return *body;
+}
+
+template <typename ArgumentGetter>
+ObjectHolder Interpreter::CallMethod(runtime::ClassInstance& instance,
+                                     const runtime::Method& method, ArgumentGetter get_arg) {
+    const Tree& tree = GetTree(method);
+
+    // Аргументы вычисляются до перехода в кадр вызываемого метода
+    if (method.frame_size > 0) {
+        runtime::PooledFrame frame(method.frame_size);
+        for (size_t i = 0; i < method.formal_params.size(); ++i) {
+            (*frame)[i + 1] = get_arg(i);
+        }
+        return CallWithFrame(tree, instance, *frame);
+    }
+
+    vector<ObjectHolder> actual_args;
+    actual_args.reserve(method.formal_params.size());
+    for (size_t i = 0; i < method.formal_params.size(); ++i) {
+        actual_args.push_back(get_arg(i));
+    }
+    return CallWithClosure(tree, instance, method, actual_args);
+}
+
+ObjectHolder Interpreter::CallWithFrame(const Tree& tree, runtime::ClassInstance& instance,
+                                        runtime::Frame& frame) {
+    frame[0] = ObjectHolder::Share(instance);
+    runtime::FrameScope frame_scope(context_, &frame);
+    Closure unused_closure;
+    return Execute(tree, tree.root, unused_closure);
+}
+
+ObjectHolder Interpreter::CallWithClosure(const Tree& tree, runtime::ClassInstance& instance,
+                                          const runtime::Method& method,
+                                          const vector<ObjectHolder>& actual_args) {
+    Closure method_vars;
+    for (size_t i = 0; i < method.formal_params.size(); ++i) {
+        method_vars[method.formal_params[i]] = actual_args[i];
+    }
+    method_vars[SELF] = ObjectHolder::Share(instance);
+
+    runtime::FrameScope frame_scope(context_, nullptr);
+    return Execute(tree, tree.root, method_vars);
+}
+
+}  // namespace flat
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "flat_ast.h"
+#include "runtime.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace flat {
+
+// Интерпретатор плоского AST. Обходит узлы дерева, выбирая действие по виду узла
+class Interpreter {
+public:
+    explicit Interpreter(runtime::Context& context);
+
+    // Исполняет дерево tree в таблице символов closure, возвращает результат корневого узла
+    runtime::ObjectHolder Run(const Tree& tree, runtime::Closure& closure);
+
+private:
+    // Вычисляет значение узла index дерева tree
+    runtime::ObjectHolder Execute(const Tree& tree, std::uint32_t index,
+                                  runtime::Closure& closure);
+    // Исполняют узлы node соответствующих видов, вычисляя их дочерние узлы
+    // Исполняет узел StoreName или StoreSlot
+    runtime::ObjectHolder ExecuteStore(const Tree& tree, const Node& node,
+                                       runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteStoreField(const Tree& tree, const Node& node,
+                                            runtime::Closure& closure);
+    runtime::ObjectHolder ExecutePrint(const Tree& tree, const Node& node,
+                                       runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteCallMethod(const Tree& tree, const Node& node,
+                                            runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteNewInstance(const Tree& tree, const Node& node,
+                                             runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteStringify(const Tree& tree, const Node& node,
+                                           runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteAdd(const Tree& tree, const Node& node,
+                                     runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteArithmetic(runtime::ArithmeticOperation operation,
+                                            const Tree& tree, const Node& node,
+                                            runtime::Closure& closure);
+    // Исполняет узел And, Or или Not
+    runtime::ObjectHolder ExecuteLogical(const Tree& tree, const Node& node,
+                                         runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteCompare(const Tree& tree, const Node& node,
+                                         runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteCompound(const Tree& tree, const Node& node,
+                                          runtime::Closure& closure);
+    // Исполняет узел MethodBody или Return
+    runtime::ObjectHolder ExecuteReturn(const Tree& tree, const Node& node,
+                                        runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteIfElse(const Tree& tree, const Node& node,
+                                        runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteDefineClass(const Tree& tree, const Node& node,
+                                             runtime::Closure& closure);
+    runtime::ObjectHolder ExecuteForeign(const Tree& tree, const Node& node,
+                                         runtime::Closure& closure);
+    // Возвращает ссылку на значение переменной либо поля, заданного узлом
+    // LoadName, LoadSlot или LoadField, без копирования промежуточных значений цепочки
+    const runtime::ObjectHolder& Locate(const Tree& tree, std::uint32_t index,
+                                        runtime::Closure& closure);
+
+    // Вызывает метод method у объекта instance. Значение i-го аргумента возвращает get_arg(i).
+    // Тело метода преобразуется в плоское AST при первом вызове
+    template <typename ArgumentGetter>
+    runtime::ObjectHolder CallMethod(runtime::ClassInstance& instance,
+                                     const runtime::Method& method, ArgumentGetter get_arg);
+    // Исполняет тело метода, использующего кадр, в кадре frame с аргументами в слотах
+    runtime::ObjectHolder CallWithFrame(const Tree& tree, runtime::ClassInstance& instance,
+                                        runtime::Frame& frame);
+    // Исполняет тело метода method, не использующего кадр, с аргументами actual_args
+    runtime::ObjectHolder CallWithClosure(const Tree& tree, runtime::ClassInstance& instance,
+                                          const runtime::Method& method,
+                                          const std::vector<runtime::ObjectHolder>& actual_args);
+    // Возвращает плоское AST тела метода method, строя его при первом вызове
+    const Tree& GetTree(const runtime::Method& method);
+    // Возвращает lhs + rhs. Вызов метода __add__ вынесен из ExecuteAdd,
+    // чтобы не увеличивать кадр ExecuteAdd, вычисляющего дочерние узлы
+    runtime::ObjectHolder Add(const runtime::ObjectHolder& lhs, const runtime::ObjectHolder& rhs);
+    // Возвращает функцию, вызывающую метод объекта без аргументов, для операций среды исполнения
+    auto CallWithoutArguments();
+
+    runtime::Context& context_;
+    std::unordered_map<const runtime::Method*, std::unique_ptr<Tree>> method_trees_;
+};
+
+}  // namespace flat
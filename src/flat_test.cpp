@@ -0,0 +1,134 @@
+#include "flat_interpreter.h"
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+
+#include <sstream>
+
+using namespace std;
+
+namespace flat {
+
+namespace {
+
+void TestNodeLayout() {
+    ASSERT(sizeof(Node) <= 16U);
+
+    ast::Add sum(make_unique<ast::NumericConst>(2),
+                 make_unique<ast::Mult>(make_unique<ast::NumericConst>(3),
+                                        make_unique<ast::VariableValue>("x"s)));
+    const Tree tree = Builder::Build(sum);
+
+    vector<NodeKind> expected = {NodeKind::Const, NodeKind::Const, NodeKind::LoadName,
+                                 NodeKind::Mult, NodeKind::Add};
+    ASSERT_EQUAL(tree.nodes.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT(tree.nodes[i].kind == expected[i]);
+    }
+    ASSERT_EQUAL(tree.root, 4U);
+
+    // Дочерние узлы предшествуют родителю и перечислены слева направо
+    const Node& root = tree.nodes[tree.root];
+    ASSERT_EQUAL(root.child_count, 2U);
+    ASSERT_EQUAL(tree.GetChild(root, 0), 0U);
+    ASSERT_EQUAL(tree.GetChild(root, 1), 3U);
+    const Node& mult = tree.nodes[3];
+    ASSERT_EQUAL(tree.GetChild(mult, 0), 1U);
+    ASSERT_EQUAL(tree.GetChild(mult, 1), 2U);
+
+    ASSERT_EQUAL(tree.constants.size(), 2U);
+    ASSERT_EQUAL(tree.names, vector<runtime::Symbol>{"x"s});
+
+    runtime::DummyContext context;
+    runtime::Closure closure{{"x"s, runtime::ObjectHolder::Own(runtime::Number(5))}};
+    Interpreter interpreter(context);
+    auto result = interpreter.Run(tree, closure);
+    ASSERT(result.TryAs<runtime::Number>() != nullptr);
+    ASSERT_EQUAL(result.TryAs<runtime::Number>()->GetValue(), 17);
+}
+
+void TestFieldChains() {
+    ast::VariableValue chain(vector<string>{"a"s, "b"s, "c"s});
+    const Tree tree = Builder::Build(chain);
+
+    ASSERT_EQUAL(tree.nodes.size(), 3U);
+    ASSERT(tree.nodes[0].kind == NodeKind::LoadName);
+    ASSERT(tree.nodes[1].kind == NodeKind::LoadField);
+    ASSERT(tree.nodes[2].kind == NodeKind::LoadField);
+    ASSERT_EQUAL(tree.field_sites.size(), 2U);
+    ASSERT_EQUAL(tree.names, (vector<runtime::Symbol>{"a"s, "b"s, "c"s}));
+}
+
+void TestRecursion() {
+    istringstream input(R"(
+class Fib:
+  def calc(n):
+    if n < 2:
+      return n
+    return self.calc(n - 1) + self.calc(n - 2)
+
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add(n):
+    self.value = self.value + n
+    return self.value
+
+fib = Fib()
+counter = Counter()
+counter.add(2)
+print fib.calc(15), counter.add(3), counter.value
+)"s);
+    parse::Lexer lexer(input);
+    auto program = ParseProgram(lexer);
+    const Tree tree = Builder::Build(*program);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    Interpreter interpreter(context);
+    interpreter.Run(tree, closure);
+    ASSERT_EQUAL(context.output.str(), "610 5 5\n"s);
+}
+
+void TestRecursionDepth() {
+    // Глубина, которую интерпретатор дерева выдерживает и в сборке без оптимизаций.
+    // Кадры Execute плоского интерпретатора не должны быть больше кадров узлов дерева
+    const string program_text = R"(
+class Chain:
+  def down(n):
+    if n == 0:
+      return 0
+    return self.down(n - 1) + 1
+
+chain = Chain()
+print chain.down(3000)
+)"s;
+    istringstream input(program_text);
+    parse::Lexer lexer(input);
+    auto program = ParseProgram(lexer);
+
+    runtime::DummyContext tree_context;
+    runtime::Closure tree_closure;
+    program->Execute(tree_closure, tree_context);
+    ASSERT_EQUAL(tree_context.output.str(), "3000\n"s);
+
+    const Tree tree = Builder::Build(*program);
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    Interpreter interpreter(context);
+    interpreter.Run(tree, closure);
+    ASSERT_EQUAL(context.output.str(), tree_context.output.str());
+}
+
+}  // namespace
+
+void RunFlatTests(TestRunner& tr) {
+    RUN_TEST(tr, flat::TestNodeLayout);
+    RUN_TEST(tr, flat::TestFieldChains);
+    RUN_TEST(tr, flat::TestRecursion);
+    RUN_TEST(tr, flat::TestRecursionDepth);
+}
+
+}  // namespace flat
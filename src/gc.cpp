@@ -0,0 +1,193 @@
+#include "gc.h"
+
+#include "runtime.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+thread_local GarbageCollector* current_collector = nullptr;
+}  // namespace
+
+GarbageCollector::GarbageCollector(size_t step_budget, size_t step_interval)
+    : step_budget_(step_budget)
+    , step_interval_(step_interval)
+{ /* do nothing */ }
+
+GarbageCollector::~GarbageCollector() {
+    for (ClassInstance* instance : instances_) {
+        instance->gc_ = nullptr;
+    }
+}
+
+size_t GarbageCollector::Step() {
+    return Collect(step_budget_);
+}
+
+size_t GarbageCollector::Collect() {
+    return Collect(UNLIMITED);
+}
+
+void GarbageCollector::OnAllocation() {
+    if (++allocations_ >= step_interval_) {
+        allocations_ = 0;
+        Step();
+    }
+}
+
+GarbageCollector* GarbageCollector::GetCurrent() {
+    return current_collector;
+}
+
+void GarbageCollector::AtSafePoint() {
+    if (current_collector != nullptr) {
+        current_collector->OnAllocation();
+    }
+}
+
+void GarbageCollector::Register(ClassInstance& instance) {
+    instance.gc_ = this;
+    instance.gc_index_ = instances_.size();
+    instances_.push_back(&instance);
+}
+
+void GarbageCollector::Unregister(ClassInstance& instance) {
+    // Место удаляемого объекта занимает последний объект списка
+    ClassInstance* last = instances_.back();
+    instances_[instance.gc_index_] = last;
+    last->gc_index_ = instance.gc_index_;
+    instances_.pop_back();
+    instance.gc_ = nullptr;
+    if (cursor_ >= instances_.size()) {
+        cursor_ = 0;
+    }
+}
+
+size_t GarbageCollector::Collect(size_t budget) {
+    const auto start = chrono::steady_clock::now();
+
+    // Рассматриваемые объекты и их индексы. Учитываются только объекты,
+    // временем жизни которых управляет счётчик ссылок
+    vector<ClassInstance*> nodes;
+    unordered_map<ClassInstance*, size_t> indices;
+    auto add_node = [&](ClassInstance* instance) {
+        if (nodes.size() < budget && instance->gc_ == this && instance->GetRefCount() > 0
+                && indices.emplace(instance, nodes.size()).second) {
+            nodes.push_back(instance);
+        }
+    };
+    auto for_each_field = [](ClassInstance* instance, auto action) {
+        if (instance->shape_ != nullptr) {
+            for (ObjectHolder& value : instance->values_) {
+                action(value);
+            }
+        }
+        else {
+            for (auto& [name, value] : *instance->fields_) {
+                action(value);
+            }
+        }
+    };
+    auto as_instance = [](const ObjectHolder& value) {
+        return value.GetType() == ObjectType::ClassInstance
+            ? static_cast<ClassInstance*>(value.Get())
+            : nullptr;
+    };
+
+    // Подграф строится из объектов, следующих за курсором, и объектов, достижимых из них.
+    // Объекты за пределами подграфа считаются достижимыми извне, поэтому рассмотрение
+    // части объектов не может освободить живой объект
+    size_t expanded = 0;
+    const size_t seed_count = min(budget, instances_.size());
+    for (size_t i = 0; i < seed_count && nodes.size() < budget; ++i) {
+        add_node(instances_[cursor_]);
+        cursor_ = (cursor_ + 1) % instances_.size();
+        for (; expanded < nodes.size() && nodes.size() < budget; ++expanded) {
+            for_each_field(nodes[expanded], [&](const ObjectHolder& value) {
+                if (ClassInstance* field = as_instance(value)) {
+                    add_node(field);
+                }
+            });
+        }
+    }
+
+    // Пробное удаление: вычитаем из счётчиков ссылки из полей рассматриваемых объектов
+    vector<uint32_t> internal_refs(nodes.size(), 0);
+    for (ClassInstance* node : nodes) {
+        for_each_field(node, [&](const ObjectHolder& value) {
+            ClassInstance* field = as_instance(value);
+            if (field != nullptr && !value.IsBorrowed()) {
+                if (auto it = indices.find(field); it != indices.end()) {
+                    ++internal_refs[it->second];
+                }
+            }
+        });
+    }
+
+    // Объекты с внешними ссылками и всё, что достижимо из них, живы
+    vector<bool> alive(nodes.size(), false);
+    vector<size_t> pending;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i]->GetRefCount() > internal_refs[i]) {
+            alive[i] = true;
+            pending.push_back(i);
+        }
+    }
+    while (!pending.empty()) {
+        ClassInstance* node = nodes[pending.back()];
+        pending.pop_back();
+        for_each_field(node, [&](const ObjectHolder& value) {
+            if (ClassInstance* field = as_instance(value)) {
+                if (auto it = indices.find(field); it != indices.end() && !alive[it->second]) {
+                    alive[it->second] = true;
+                    pending.push_back(it->second);
+                }
+            }
+        });
+    }
+
+    // Поля мусорных объектов переносятся в released без изменения счётчиков ссылок.
+    // Объекты освобождаются при очистке released, когда их поля уже пусты
+    vector<ObjectHolder> released;
+    size_t collected = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (alive[i]) {
+            continue;
+        }
+        ClassInstance* node = nodes[i];
+        ++collected;
+        bytes += sizeof(ClassInstance) + node->values_.capacity() * sizeof(ObjectHolder);
+        if (node->fields_) {
+            bytes += node->fields_->size() * sizeof(Closure::value_type);
+        }
+        for_each_field(node, [&](ObjectHolder& value) {
+            released.push_back(std::move(value));
+        });
+    }
+    released.clear();
+
+    const auto pause = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now() - start);
+    ++stats_.collections;
+    stats_.objects_collected += collected;
+    stats_.bytes_collected += bytes;
+    stats_.total_pause += pause;
+    stats_.max_pause = max(stats_.max_pause, pause);
+    return collected;
+}
+
+GcScope::GcScope(GarbageCollector* collector)
+    : prev_(current_collector) {
+    current_collector = collector;
+}
+
+GcScope::~GcScope() {
+    current_collector = prev_;
+}
+
+}  // namespace runtime
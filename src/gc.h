@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace runtime {
+
+class ClassInstance;
+
+// Статистика работы сборщика циклов
+struct GcStats {
+    size_t collections = 0;       // Количество выполненных сборок (шагов)
+    size_t objects_collected = 0; // Количество освобождённых объектов
+    size_t bytes_collected = 0;   // Оценка объёма освобождённой памяти
+    std::chrono::nanoseconds total_pause{0}; // Суммарное время пауз
+    std::chrono::nanoseconds max_pause{0};   // Наибольшая пауза
+};
+
+/*
+ * Сборщик циклических ссылок между экземплярами классов.
+ *
+ * Объекты освобождаются счётчиком ссылок ObjectHolder, но объекты, ссылающиеся друг на друга
+ * через поля, удерживают друг друга бесконечно. Сборщик отслеживает экземпляры классов,
+ * созданные, пока он установлен в потоке через GcScope, и находит циклы пробным удалением:
+ * объект, на который ссылается больше ObjectHolder, чем полей рассматриваемых объектов,
+ * достижим извне (из глобального Closure, кадров методов, стека виртуальной машины,
+ * констант AST). Объекты, не достижимые из таких объектов, образуют мусор.
+ *
+ * Каждый шаг рассматривает не более заданного числа объектов, что ограничивает паузу.
+ * Циклы, не поместившиеся в один шаг, остаются до полной сборки Collect
+ */
+class GarbageCollector {
+public:
+    static constexpr size_t DEFAULT_STEP_BUDGET = 4096;
+    static constexpr size_t DEFAULT_STEP_INTERVAL = 4096;
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+    // step_budget - наибольшее число объектов, рассматриваемых за шаг,
+    // step_interval - число созданных объектов, после которого выполняется очередной шаг
+    explicit GarbageCollector(size_t step_budget = DEFAULT_STEP_BUDGET,
+                              size_t step_interval = DEFAULT_STEP_INTERVAL);
+
+    GarbageCollector(const GarbageCollector&) = delete;
+    GarbageCollector& operator=(const GarbageCollector&) = delete;
+
+    // Прекращает отслеживание оставшихся объектов, не освобождая их
+    ~GarbageCollector();
+
+    // Выполняет шаг сборки. Возвращает количество освобождённых объектов
+    size_t Step();
+    // Рассматривает все отслеживаемые объекты и освобождает все недостижимые циклы
+    size_t Collect();
+
+    // Сообщает о создании объекта. Вызывается в точках, где сборка безопасна:
+    // все живые объекты удерживаются владеющими ObjectHolder
+    void OnAllocation();
+
+    [[nodiscard]] const GcStats& GetStats() const {
+        return stats_;
+    }
+
+    // Возвращает количество отслеживаемых объектов
+    [[nodiscard]] size_t GetTrackedCount() const {
+        return instances_.size();
+    }
+
+    // Возвращает сборщик, установленный GcScope в текущем потоке, либо nullptr
+    [[nodiscard]] static GarbageCollector* GetCurrent();
+
+    // Вызывает OnAllocation у сборщика текущего потока, если он установлен
+    static void AtSafePoint();
+
+private:
+    friend class ClassInstance;
+
+    void Register(ClassInstance& instance);
+    void Unregister(ClassInstance& instance);
+
+    size_t Collect(size_t budget);
+
+    std::vector<ClassInstance*> instances_;
+    size_t cursor_ = 0; // Объект, с которого начнётся следующий шаг
+    size_t step_budget_;
+    size_t step_interval_;
+    size_t allocations_ = 0;
+    GcStats stats_;
+};
+
+// Делает сборщик текущим для своего потока на время своего существования
+class GcScope {
+public:
+    explicit GcScope(GarbageCollector* collector);
+
+    GcScope(const GcScope&) = delete;
+    GcScope& operator=(const GcScope&) = delete;
+
+    ~GcScope();
+
+private:
+    GarbageCollector* prev_;
+};
+
+}  // namespace runtime
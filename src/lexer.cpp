@@ -1,8 +1,12 @@
 #include "lexer.h"
 
+#include "scan.h"
+
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <charconv>
+#include <thread>
 #include <unordered_map>
 
 #include "iostream" // DEBUG
@@ -14,7 +18,7 @@ namespace parse {
 bool operator==(const Token& lhs, const Token& rhs) {
     using namespace token_type;
 
-    if (lhs.index() != rhs.index()) {
+    if (lhs.GetKind() != rhs.GetKind()) {
         return false;
     }
     if (lhs.Is<Char>()) {
@@ -78,9 +82,71 @@ std::ostream& operator<<(std::ostream& os, const Token& rhs) {
     return os << "Unknown token :("sv;
 }
 
+namespace {
+// Ключевое слово и функция, создающая его лексему
+struct Keyword {
+    string_view text;
+    Token (*make_token)() = nullptr;
+};
+
+template <typename T>
+Token MakeToken() {
+    return T{};
+}
+
+constexpr Keyword KEYWORDS[] = {
+    {"class"sv, MakeToken<token_type::Class>},   {"return"sv, MakeToken<token_type::Return>},
+    {"if"sv, MakeToken<token_type::If>},         {"else"sv, MakeToken<token_type::Else>},
+    {"def"sv, MakeToken<token_type::Def>},       {"print"sv, MakeToken<token_type::Print>},
+    {"and"sv, MakeToken<token_type::And>},       {"or"sv, MakeToken<token_type::Or>},
+    {"not"sv, MakeToken<token_type::Not>},       {"None"sv, MakeToken<token_type::None>},
+    {"True"sv, MakeToken<token_type::True>},     {"False"sv, MakeToken<token_type::False>},
+};
+
+// Размер таблицы ключевых слов, степень двойки
+constexpr size_t KEYWORD_TABLE_SIZE = 16;
+
+// Совершенная хеш-функция ключевых слов: у разных ключевых слов различные значения.
+// Идентификатор id не должен быть пустым
+constexpr size_t KeywordHash(string_view id) {
+    return (id.size() * 4 + static_cast<unsigned char>(id.front())
+            + static_cast<unsigned char>(id.back()) * 11) & (KEYWORD_TABLE_SIZE - 1);
+}
+
+// Раскладывает ключевые слова по ячейкам таблицы согласно KeywordHash.
+// Совпадение хешей двух ключевых слов приводит к ошибке компиляции
+constexpr array<Keyword, KEYWORD_TABLE_SIZE> MakeKeywordTable() {
+    array<Keyword, KEYWORD_TABLE_SIZE> table{};
+    for (const Keyword& keyword : KEYWORDS) {
+        Keyword& cell = table[KeywordHash(keyword.text)];
+        if (!cell.text.empty()) {
+            throw logic_error("Keyword hash collision");
+        }
+        cell = keyword;
+    }
+    return table;
+}
+
+// Таблица ключевых слов, построенная при компиляции. Пустые ячейки не совпадают
+// ни с одним идентификатором, так как идентификаторы не бывают пустыми
+constexpr array<Keyword, KEYWORD_TABLE_SIZE> KEYWORD_TABLE = MakeKeywordTable();
+}  // namespace
+
 Lexer::Lexer(std::istream& input)
-    : input_(input)
+    : Lexer(Source::FromStream(input))
+{ /* do nothing */ }
+
+Lexer::Lexer(Source source, unsigned thread_count)
+    : source_(std::move(source))
+    , pos_(source_.GetText().data())
+    , end_(pos_ + source_.GetText().size())
 {
+    // Небольшие тексты быстрее разобрать в одном потоке
+    thread_count = static_cast<unsigned>(min<size_t>(thread_count,
+                                                     source_.GetText().size() / MIN_CHUNK_SIZE));
+    if (thread_count > 1) {
+        TokenizeInParallel(thread_count);
+    }
     NextToken();
 }
 
@@ -98,8 +164,17 @@ Token Lexer::NextToken() {
         return tokens_.back();
     }
 
+    // Все лексемы, разобранные до ошибки параллельного разбора, выданы
+    if (pending_error_) {
+        rethrow_exception(pending_error_);
+    }
+
+    // Токены текущей строки прочитаны, окно заполняется токенами следующей строки
+    tokens_.clear();
+    strings_.clear();
+    current_pos_ = -1;
     while (true) {
-        TokenLine token_line = GetTokenLine(input_);
+        TokenLine token_line = GetTokenLine();
 
         if (token_line.IsEmpty()) {
             continue;
@@ -113,18 +188,141 @@ Token Lexer::NextToken() {
     return tokens_.at(++current_pos_);
 }
 
-Lexer::TokenLine::TokenLine(std::istream& input) : input_(input) {}
+size_t Lexer::GetWindowSize() const {
+    return tokens_.size();
+}
+
+optional<Lexer::SkippedBlock> Lexer::SkipBlock() {
+    // Строки можно пропустить, только пока за текущей лексемой не разобрано ни одной
+    if (current_pos_ + 1 != static_cast<int>(tokens_.size())
+        || !CurrentToken().Is<token_type::Newline>()) {
+        return nullopt;
+    }
+
+    constexpr string_view class_keyword = "class"sv;
+    const char* block_end = pos_;
+    for (const char* line = pos_; line != end_;) {
+        const char* text = scan::SkipSpaces(line, end_);
+        const char* line_end = scan::FindLineEnd(text, end_);
+        const char* next_line = line_end != end_ ? line_end + 1 : end_;
+        // Строки из пробелов и комментариев не завершают блок
+        if (text != line_end && *text != '#') {
+            if (text - line <= 2 * current_indent_) {
+                break;
+            }
+            const string_view line_text(text, line_end - text);
+            if (line_text.substr(0, class_keyword.size()) == class_keyword
+                && (line_text.size() == class_keyword.size()
+                    || !scan::Is(line_text[class_keyword.size()], scan::ID))) {
+                return nullopt;
+            }
+            block_end = next_line;
+        }
+        line = next_line;
+    }
+
+    if (block_end == pos_) {
+        return nullopt;
+    }
+    SkippedBlock block{string_view(pos_, block_end - pos_), current_indent_};
+    pos_ = block_end;
+    return block;
+}
+
+void Lexer::TokenizeInParallel(unsigned thread_count) {
+    // Текст делится на части примерно равного размера, каждая часть заканчивается
+    // переводом строки либо концом текста. Строки разбираются независимо друг от друга
+    vector<pair<const char*, const char*>> ranges;
+    const size_t chunk_size = (end_ - pos_) / thread_count;
+    for (const char* begin = pos_; begin != end_;) {
+        const char* end = end_;
+        if (ranges.size() + 1 < thread_count) {
+            end = scan::FindLineEnd(begin + min<size_t>(chunk_size, end_ - begin), end_);
+            end += end != end_ ? 1 : 0;
+        }
+        ranges.emplace_back(begin, end);
+        begin = end;
+    }
+
+    vector<Chunk> chunks(ranges.size());
+    vector<thread> threads;
+    threads.reserve(ranges.size() - 1);
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        threads.emplace_back([this, &ranges, &chunks, i] {
+            TokenizeChunk(ranges[i].first, ranges[i].second, chunks[i]);
+        });
+    }
+    if (!ranges.empty()) {
+        TokenizeChunk(ranges[0].first, ranges[0].second, chunks[0]);
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    // Отступы зависят от предыдущих строк, поэтому лексемы Indent и Dedent
+    // расставляются последовательно
+    size_t token_count = 0;
+    for (const Chunk& chunk : chunks) {
+        token_count += chunk.tokens.size();
+    }
+    tokens_.reserve(token_count);
+    for (Chunk& chunk : chunks) {
+        size_t line_begin = 0;
+        for (const Chunk::Line& line : chunk.lines) {
+            UpdateIndent(line.indent);
+            tokens_.insert(tokens_.end(), chunk.tokens.begin() + line_begin,
+                           chunk.tokens.begin() + line.end);
+            line_begin = line.end;
+        }
+        chunk_strings_.push_back(std::move(chunk.strings));
+        if (chunk.error) {
+            pending_error_ = chunk.error;
+            break;
+        }
+    }
+    pos_ = end_;
+}
+
+void Lexer::TokenizeChunk(const char* begin, const char* end, Chunk& chunk) const {
+    try {
+        while (begin != end || end == end_) {
+            TokenLine token_line(begin, end, chunk.strings);
+            token_line.ReadLine();
+            if (token_line.IsEmpty()) {
+                continue;
+            }
+
+            const vector<Token>& tokens = token_line.GetTokens();
+            chunk.tokens.insert(chunk.tokens.end(), tokens.begin(), tokens.end());
+            chunk.lines.push_back({token_line.GetIndent(), chunk.tokens.size()});
+            if (tokens.back().Is<token_type::Eof>()) {
+                break;
+            }
+        }
+    }
+    catch (...) {
+        chunk.error = current_exception();
+    }
+}
+
+Lexer::TokenLine::TokenLine(const char*& pos, const char* end, std::deque<std::string>& strings)
+    : pos_(pos)
+    , end_(end)
+    , strings_(strings) {
+}
 
 Lexer::TokenLine& Lexer::TokenLine::ReadLine() {
     CountIndents();
 
-    char ch;
-    while (!input_.eof() && input_.get(ch)) {
+    while (pos_ != end_) {
+        const char ch = *pos_;
         if (ch == '\n') {
+            ++pos_;
             tokens_.emplace_back(token_type::Newline());
-            break;
+            return *this;
         }
         if (ch == ' ') {
+            pos_ = scan::SkipSpaces(pos_, end_);
             continue;
         }
 
@@ -132,43 +330,39 @@ Lexer::TokenLine& Lexer::TokenLine::ReadLine() {
             ReadComment();
         }
         else if (ch == '"' || ch == '\'') {
+            ++pos_;
             tokens_.push_back(ReadString(ch));
         }
-        else if (isdigit(ch)) {
-            input_.putback(ch);
+        else if (scan::Is(ch, scan::DIGIT)) {
             tokens_.push_back(ReadNumber());
         }
-        else if (isalpha(ch) || ch == '_') {
-            input_.putback(ch);
+        else if (scan::Is(ch, scan::ID_START)) {
             tokens_.push_back(ReadId());
         }
         else if ((ch == '=' || ch == '!' || ch == '<' || ch == '>')
-            && input_.peek() == '=')
+            && end_ - pos_ > 1 && pos_[1] == '=')
         {
-            input_.putback(ch);
             tokens_.push_back(ReadEq());
         }
         else {
+            ++pos_;
             tokens_.push_back(token_type::Char{ ch });
         }
     }
 
-    // Если был достигнут конец потока - добавляем соответствующую лексему в tokens_
-    if (input_.eof()) {
-        if (!tokens_.empty() && !tokens_.back().Is<token_type::Newline>()) {
-            tokens_.emplace_back(token_type::Newline());
-        }
-        tokens_.emplace_back(token_type::Eof());
+    // Если был достигнут конец текста - добавляем соответствующую лексему в tokens_
+    if (!tokens_.empty() && !tokens_.back().Is<token_type::Newline>()) {
+        tokens_.emplace_back(token_type::Newline());
     }
+    tokens_.emplace_back(token_type::Eof());
 
     return *this;
 }
 
 void Lexer::TokenLine::CountIndents() {
-    while (input_.peek() == ' ') {
-        ++line_indent_;
-        input_.get();
-    }
+    const char* begin = pos_;
+    pos_ = scan::SkipSpaces(pos_, end_);
+    line_indent_ = static_cast<int>(pos_ - begin);
 
     if (line_indent_ % 2 != 0) {
         throw LexerError("Wrong indents number"s);
@@ -177,162 +371,110 @@ void Lexer::TokenLine::CountIndents() {
     line_indent_ /= 2;
 }
 void Lexer::TokenLine::ReadComment() {
-    while (input_.get() != '\n' && !input_.eof()) {}
-    if (!input_.eof()) {
-        input_.unget();
-    }
-
+    // Перевод строки остаётся непрочитанным и завершает строку
+    pos_ = scan::FindLineEnd(pos_, end_);
 }
 Token Lexer::TokenLine::ReadString(char quote) const {
-    auto it = istreambuf_iterator<char>(input_);
-    auto end_it = istreambuf_iterator<char>();
+    // Строка без escape-последовательностей ссылается прямо на исходный текст
+    const char* begin = pos_;
+    pos_ = scan::FindStringStop(pos_, end_, quote);
+    if (pos_ != end_ && *pos_ == quote) {
+        return token_type::String{string_view(begin, pos_++ - begin)};
+    }
 
-    token_type::String line;
+    string line(begin, pos_);
 
     while (true) {
         // Если строка закончилась без знака '"' или '\''
         // - выбрасываем исключение LexerError
-        if (it == end_it) {
+        if (pos_ == end_) {
             throw LexerError("String parsing error"s);
         }
 
-        const char ch = *it;
+        const char ch = *pos_;
 
         // Если строка закончилась корректным символом - выходим из цикла
         if (ch == quote) {
-            ++it;
+            ++pos_;
             break;
         }
 
         // Если встретился символ '\' - следующим должен идти
         // один из спецсимволов: 'n', 't', '"', '\''
         if (ch == '\\') {
-            ++it;
+            ++pos_;
 
-            if (it == end_it) {
+            if (pos_ == end_) {
                 throw LexerError("String parsing error"s);
             }
 
-            const char spec_char = *it;
+            const char spec_char = *pos_;
 
             switch(spec_char) {
             case 'n':
-                line.value.push_back('\n');
+                line.push_back('\n');
                 break;
             case 't':
-                line.value.push_back('\t');
+                line.push_back('\t');
                 break;
             case '"':
-                line.value.push_back('"');
+                line.push_back('"');
                 break;
             case '\'':
-                line.value.push_back('\'');
+                line.push_back('\'');
                 break;
             default:
                 throw LexerError("Wrong special symbol appeared"s);
             }
-            ++it;
-        }
-        // Если строка внезапно прерывается - выбрасываем исключение
-        else if (ch == '\n' || ch == '\r') {
-            throw LexerError("Unexpected end of line"s);
+            ++pos_;
         }
+        // Иначе строка внезапно прерывается - выбрасываем исключение
         else {
-            ++it;
-            line.value.push_back(ch);
+            throw LexerError("Unexpected end of line"s);
         }
+
+        // Символы до следующей кавычки либо escape-последовательности копируются целиком
+        const char* stop = scan::FindStringStop(pos_, end_, quote);
+        line.append(pos_, stop);
+        pos_ = stop;
     }
 
-    return line;
+    strings_.push_back(std::move(line));
+    return token_type::String{strings_.back()};
 }
 Token Lexer::TokenLine::ReadNumber() const {
     token_type::Number num;
-    string num_str;
 
-    // Вносим минус при наличии
-    if (input_.peek() == '-') {
-        input_.get();
-        num_str.push_back('-');
-    }
-    // Последовательно считываем все цифры
-    while (isdigit(input_.peek())) {
-        num_str.push_back(input_.get());
-    }
-
-    // Преобразовываем получившуюся строку в число.
+    // Число разбирается прямо из исходного текста, без построения промежуточной строки.
     // В случае неудачи - выбрасываем исключение LexerError
-    try {
-        num.value = stoi(num_str);
-    }
-    catch (...) {
+    const auto [end, error] = from_chars(pos_, end_, num.value);
+    if (error != errc()) {
         throw LexerError("Number parsing error"s);
     }
+    pos_ = end;
 
     return num;
 }
 Token Lexer::TokenLine::ReadId() const {
-    string id = "";
-    char ch;
-
-    while (input_.get(ch)) {
-        if (!isalpha(ch) && !isdigit(ch) && ch != '_') {
-            input_.putback(ch);
-            break;
-        }
-        id.push_back(ch);
-    }
+    const char* begin = pos_;
+    pos_ = scan::SkipIdChars(pos_, end_);
+    const string_view id(begin, pos_ - begin);
 
     if (id.empty()) {
         throw LexerError("Id parsing error occured"s);
     }
 
     // Проверяем идентификатор на соответствие ключевым словам
-    if (id == "class"s) {
-        return token_type::Class();
-    }
-    if (id == "return"s) {
-        return token_type::Return();
-    }
-    if (id == "if"s) {
-        return token_type::If();
-    }
-    if (id == "return"s) {
-        return token_type::Return();
-    }
-    if (id == "else"s) {
-        return token_type::Else();
-    }
-    if (id == "def"s) {
-        return token_type::Def();
-    }
-    if (id == "print"s) {
-        return token_type::Print();
-    }
-    if (id == "and"s) {
-        return token_type::And();
-    }
-    if (id == "or"s) {
-        return token_type::Or();
-    }
-    if (id == "not"s) {
-        return token_type::Not();
-    }
-    if (id == "None"s) {
-        return token_type::None();
-    }
-    if (id == "True"s) {
-        return token_type::True();
-    }
-    if (id == "False"s) {
-        return token_type::False();
+    if (const Keyword& keyword = KEYWORD_TABLE[KeywordHash(id)]; keyword.text == id) {
+        return keyword.make_token();
     }
 
     // Если идентификатор не соответствует ни одному ключевому слову - создаем новый
-    return token_type::Id{ id };
+    return token_type::Id{ runtime::Symbol(id) };
 }
 Token Lexer::TokenLine::ReadEq() const {
-    char ch = input_.get();
-    input_.get(); // Считываем из потока и второй символ
+    const char ch = *pos_;
+    pos_ += 2; // Пропускаем и второй символ
 
     switch (ch) {
     case '=':
@@ -377,8 +519,8 @@ void Lexer::UpdateIndent(int new_indent) {
     current_indent_ = new_indent;
 }
 
-Lexer::TokenLine Lexer::GetTokenLine(std::istream& input) const {
-    TokenLine token_line(input);
+Lexer::TokenLine Lexer::GetTokenLine() {
+    TokenLine token_line(pos_, end_, strings_);
     return token_line.ReadLine();
 }
 
@@ -1,81 +1,160 @@
 #pragma once
 
+#include "source.h"
+#include "symbol.h"
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <iosfwd>
+#include <new>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <variant>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 namespace parse {
 
+// Вид лексемы
+enum class TokenKind : std::uint8_t {
+    Number, Id, Char, String, Class, Return, If, Else, Def, Newline, Print, Indent, Dedent,
+    And, Or, Not, Eq, NotEq, LessOrEq, GreaterOrEq, None, True, False, Eof,
+};
+
 namespace token_type {
 struct Number {  // Лексема «число»
+    static constexpr TokenKind KIND = TokenKind::Number;
     int value;   // число
 };
 
-struct Id {             // Лексема «идентификатор»
-    std::string value;  // Имя идентификатора
+struct Id {                // Лексема «идентификатор»
+    static constexpr TokenKind KIND = TokenKind::Id;
+    runtime::Symbol value; // Имя идентификатора, интернированное в таблице символов
 };
 
 struct Char {    // Лексема «символ»
+    static constexpr TokenKind KIND = TokenKind::Char;
     char value;  // код символа
 };
 
 struct String {  // Лексема «строковая константа»
-    std::string value;
+    static constexpr TokenKind KIND = TokenKind::String;
+    // Содержимое строки. Для лексем, полученных от Lexer, действительно,
+    // пока лексер не перешёл к следующей строке программы. Строки без
+    // escape-последовательностей ссылаются прямо на исходный текст
+    std::string_view value;
 };
 
-struct Class {};    // Лексема «class»
-struct Return {};   // Лексема «return»
-struct If {};       // Лексема «if»
-struct Else {};     // Лексема «else»
-struct Def {};      // Лексема «def»
-struct Newline {};  // Лексема «конец строки»
-struct Print {};    // Лексема «print»
-struct Indent {};  // Лексема «увеличение отступа», соответствует двум пробелам
-struct Dedent {};  // Лексема «уменьшение отступа»
-struct Eof {};     // Лексема «конец файла»
-struct And {};     // Лексема «and»
-struct Or {};      // Лексема «or»
-struct Not {};     // Лексема «not»
-struct Eq {};      // Лексема «==»
-struct NotEq {};   // Лексема «!=»
-struct LessOrEq {};     // Лексема «<=»
-struct GreaterOrEq {};  // Лексема «>=»
-struct None {};         // Лексема «None»
-struct True {};         // Лексема «True»
-struct False {};        // Лексема «False»
+#define PARSE_TOKEN_TYPE(type) \
+    struct type { static constexpr TokenKind KIND = TokenKind::type; }
+
+PARSE_TOKEN_TYPE(Class);    // Лексема «class»
+PARSE_TOKEN_TYPE(Return);   // Лексема «return»
+PARSE_TOKEN_TYPE(If);       // Лексема «if»
+PARSE_TOKEN_TYPE(Else);     // Лексема «else»
+PARSE_TOKEN_TYPE(Def);      // Лексема «def»
+PARSE_TOKEN_TYPE(Newline);  // Лексема «конец строки»
+PARSE_TOKEN_TYPE(Print);    // Лексема «print»
+PARSE_TOKEN_TYPE(Indent);  // Лексема «увеличение отступа», соответствует двум пробелам
+PARSE_TOKEN_TYPE(Dedent);  // Лексема «уменьшение отступа»
+PARSE_TOKEN_TYPE(Eof);     // Лексема «конец файла»
+PARSE_TOKEN_TYPE(And);     // Лексема «and»
+PARSE_TOKEN_TYPE(Or);      // Лексема «or»
+PARSE_TOKEN_TYPE(Not);     // Лексема «not»
+PARSE_TOKEN_TYPE(Eq);      // Лексема «==»
+PARSE_TOKEN_TYPE(NotEq);   // Лексема «!=»
+PARSE_TOKEN_TYPE(LessOrEq);     // Лексема «<=»
+PARSE_TOKEN_TYPE(GreaterOrEq);  // Лексема «>=»
+PARSE_TOKEN_TYPE(None);         // Лексема «None»
+PARSE_TOKEN_TYPE(True);         // Лексема «True»
+PARSE_TOKEN_TYPE(False);        // Лексема «False»
+
+#undef PARSE_TOKEN_TYPE
 }  // namespace token_type
 
-using TokenBase
-    = std::variant<token_type::Number, token_type::Id, token_type::Char, token_type::String,
-                   token_type::Class, token_type::Return, token_type::If, token_type::Else,
-                   token_type::Def, token_type::Newline, token_type::Print, token_type::Indent,
-                   token_type::Dedent, token_type::And, token_type::Or, token_type::Not,
-                   token_type::Eq, token_type::NotEq, token_type::LessOrEq, token_type::GreaterOrEq,
-                   token_type::None, token_type::True, token_type::False, token_type::Eof>;
+/*
+ * Лексема. Хранит вид лексемы и её значение в 16 байтах: число, символ, интернированное
+ * имя идентификатора либо указатель и длину содержимого строковой константы.
+ * Содержимое строковых констант принадлежит лексеру, создавшему лексему
+ */
+class Token {
+public:
+    // Создаёт лексему из значения одного из типов token_type
+    template <typename T, typename = decltype(T::KIND)>
+    Token(const T& value);  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
 
-struct Token : TokenBase {
-    using TokenBase::TokenBase;
+    [[nodiscard]] TokenKind GetKind() const {
+        return kind_;
+    }
 
     template <typename T>
     [[nodiscard]] bool Is() const {
-        return std::holds_alternative<T>(*this);
+        return kind_ == T::KIND;
     }
 
+    // Возвращает значение лексемы вида T. Лексема должна иметь вид T
     template <typename T>
-    [[nodiscard]] const T& As() const {
-        return std::get<T>(*this);
-    }
+    [[nodiscard]] T As() const;
 
+    // Возвращает значение лексемы вида T либо nullopt, если лексема имеет другой вид
     template <typename T>
-    [[nodiscard]] const T* TryAs() const {
-        return std::get_if<T>(this);
+    [[nodiscard]] std::optional<T> TryAs() const {
+        return Is<T>() ? std::optional<T>(As<T>()) : std::nullopt;
     }
+
+private:
+    TokenKind kind_;
+    std::uint32_t size_ = 0; // Длина строковой константы
+    union {
+        int number_;
+        char char_;
+        runtime::Symbol id_;
+        const char* data_;   // Содержимое строковой константы
+    };
 };
 
+template <typename T, typename>
+Token::Token(const T& value)
+    : kind_(T::KIND) {
+    if constexpr (std::is_same_v<T, token_type::Number>) {
+        number_ = value.value;
+    }
+    else if constexpr (std::is_same_v<T, token_type::Char>) {
+        char_ = value.value;
+    }
+    else if constexpr (std::is_same_v<T, token_type::Id>) {
+        new (&id_) runtime::Symbol(value.value);
+    }
+    else if constexpr (std::is_same_v<T, token_type::String>) {
+        data_ = value.value.data();
+        size_ = static_cast<std::uint32_t>(value.value.size());
+    }
+}
+
+template <typename T>
+T Token::As() const {
+    assert(Is<T>());
+    if constexpr (std::is_same_v<T, token_type::Number>) {
+        return T{number_};
+    }
+    else if constexpr (std::is_same_v<T, token_type::Char>) {
+        return T{char_};
+    }
+    else if constexpr (std::is_same_v<T, token_type::Id>) {
+        return T{id_};
+    }
+    else if constexpr (std::is_same_v<T, token_type::String>) {
+        return T{std::string_view(data_, size_)};
+    }
+    else {
+        return T{};
+    }
+}
+
 bool operator==(const Token& lhs, const Token& rhs);
 bool operator!=(const Token& lhs, const Token& rhs);
 
@@ -86,9 +165,27 @@ public:
     using std::runtime_error::runtime_error;
 };
 
+/*
+ * Лексер разбирает исходный текст, размещённый в памяти непрерывным блоком, сканируя его
+ * указателем. Поток ввода, переданный в конструктор, считывается в память целиком.
+ *
+ * Если лексеру разрешено использовать несколько потоков, большой текст разбивается
+ * по границам строк на части, которые разбираются параллельно. Лексемы отступов
+ * расставляются затем последовательно. В этом режиме лексер хранит лексемы всей программы
+ */
 class Lexer {
 public:
+    // Минимальный размер части текста, разбираемой отдельным потоком
+    static constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
     explicit Lexer(std::istream& input);
+    // Разбирает текст source, используя не более thread_count потоков
+    explicit Lexer(Source source, unsigned thread_count = 1);
+
+    // Возвращает разбираемый текст программы
+    [[nodiscard]] std::string_view GetText() const {
+        return source_.GetText();
+    }
 
     // Возвращает ссылку на текущий токен или token_type::Eof, если поток токенов закончился
     [[nodiscard]] const Token& CurrentToken() const;
@@ -96,38 +193,67 @@ public:
     // Возвращает следующий токен, либо token_type::Eof, если поток токенов закончился
     Token NextToken();
 
-    // Если текущий токен имеет тип T, метод возвращает ссылку на него.
+    // Если текущий токен имеет тип T, метод возвращает его значение.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T>
-    const T& Expect() const;
+    T Expect() const;
 
     // Метод проверяет, что текущий токен имеет тип T, а сам токен содержит значение value.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T, typename U>
     void Expect(const U& value) const;
 
-    // Если следующий токен имеет тип T, метод возвращает ссылку на него.
+    // Если следующий токен имеет тип T, метод возвращает его значение.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T>
-    const T& ExpectNext();
+    T ExpectNext();
 
     // Метод проверяет, что следующий токен имеет тип T, а сам токен содержит значение value.
     // В противном случае метод выбрасывает исключение LexerError
     template <typename T, typename U>
     void ExpectNext(const U& value);
 
+    // Возвращает количество токенов, хранящихся лексером. При разборе в одном потоке лексер
+    // хранит только токены текущей строки программы, поэтому их количество не зависит
+    // от длины программы
+    [[nodiscard]] size_t GetWindowSize() const;
+
+    // Блок строк, пропущенный лексером без разбора на лексемы
+    struct SkippedBlock {
+        std::string_view text; // Текст строк блока вместе с их отступами
+        int indent;            // Отступ строки, за которой следует блок
+    };
+
+    // Пропускает без разбора строки, следующие за текущей лексемой Newline и имеющие больший
+    // отступ, чем строка этой лексемы, так что следующей будет выдана первая лексема строки
+    // за блоком. Возвращает nullopt и не меняет состояния лексера, если блок пуст, содержит
+    // определение класса (классы объявляются при разборе) либо лексемы текста уже разобраны
+    // в нескольких потоках
+    std::optional<SkippedBlock> SkipBlock();
+
 private:
-    std::istream& input_;       // Поток ввода
+    Source source_;             // Исходный текст программы
+    const char* pos_;           // Позиция первого непрочитанного символа source_
+    const char* end_;           // Конец текста source_
     int current_indent_ = 0;    // Текущий отступ
     int current_pos_ = -1;      // Текущая выводимая позиция в tokens_
-    std::vector<Token> tokens_; // Последовательность токенов
-
-    // Класс является представлением считанной из потока input строки в токенах
+    // Окно токенов: изменения отступа и токены текущей строки программы.
+    // Токены строки отбрасываются при переходе к следующей строке
+    std::vector<Token> tokens_;
+    std::deque<std::string> strings_; // Содержимое строковых констант окна
+    // Содержимое строковых констант, найденных при параллельном разборе
+    std::vector<std::deque<std::string>> chunk_strings_;
+    // Ошибка параллельного разбора, выбрасываемая после выдачи лексем, предшествующих ей
+    std::exception_ptr pending_error_;
+
+    // Класс является представлением считанной из текста строки в токенах
     class TokenLine final {
     public:
-        explicit TokenLine(std::istream& input);
+        // Строка считывается с позиции pos, которая сдвигается на начало следующей строки.
+        // Содержимое строковых констант с escape-последовательностями сохраняется в strings
+        TokenLine(const char*& pos, const char* end, std::deque<std::string>& strings);
 
-        // Метод считывает очередную строку из input_,
+        // Метод считывает очередную строку текста,
         // возвращает ссылку на текущий объект
         TokenLine& ReadLine();
 
@@ -140,7 +266,9 @@ private:
         const std::vector<Token>& GetTokens() const;
 
     private:
-        std::istream& input_;       // Поток ввода
+        const char*& pos_;          // Текущая позиция в тексте
+        const char* end_;           // Конец текста
+        std::deque<std::string>& strings_; // Содержимое строковых констант
         int line_indent_ = 0;       // Отступ в строке
         std::vector<Token> tokens_; // Последовательность токенов в строке
 
@@ -149,29 +277,49 @@ private:
         void CountIndents();
         // Метод считывает комментарий до конца строки/файла
         void ReadComment();
-        // Метод считывает строку из потока ввода, заключенные в кавычки символом ch,
+        // Метод считывает строку, заключенную в кавычки символом quote,
         // возвращает токен типа String. В случае неудачи выбрасывает исключение LexerError
         [[nodiscard]] Token ReadString(char quote) const;
-        // Метод считывает число из потока ввода, возвращает токен типа Number.
+        // Метод считывает число, возвращает токен типа Number.
         // В случае неудачи выбрасывает исключение LexerError
         [[nodiscard]] Token ReadNumber() const;
-        // Метод считывает идентификатор из потока ввода, возвращает токен типа Id.
+        // Метод считывает идентификатор, возвращает токен типа Id.
         // В случае неудачи выбрасывает исключение LexerError
         [[nodiscard]] Token ReadId() const;
-        // Метод считывает лексему эквивалентности из потока ввода,
+        // Метод считывает лексему эквивалентности,
         // возвращает токен одного из типов: Eq, NotEq, LessOrEq, GreaterOrEq.
         // В случае неудачи выбрасывает исключение LexerError
         [[nodiscard]] Token ReadEq() const;
     };
 
+    // Лексемы части текста, разобранной отдельным потоком
+    struct Chunk {
+        // Непустая строка части: отступ и позиция в tokens за последней лексемой строки
+        struct Line {
+            int indent;
+            size_t end;
+        };
+
+        std::vector<Token> tokens;
+        std::vector<Line> lines;
+        std::deque<std::string> strings;
+        std::exception_ptr error; // Ошибка, прервавшая разбор части
+    };
+
+    // Разбирает текст частями в thread_count потоках и заполняет tokens_ лексемами всей программы
+    void TokenizeInParallel(unsigned thread_count);
+    // Разбирает строки текста [begin, end) в chunk. Если end - конец текста, разбор
+    // завершается лексемой Eof
+    void TokenizeChunk(const char* begin, const char* end, Chunk& chunk) const;
+
     // Метод обновляет отступ и добавляет соответствующие токены при необходимости
     void UpdateIndent(int new_indent);
 
-    TokenLine GetTokenLine(std::istream& input) const;
+    TokenLine GetTokenLine();
 };
 
 template <typename T>
-const T& Lexer::Expect() const {
+T Lexer::Expect() const {
     using namespace std::literals;
 
     if (CurrentToken().Is<T>()) {
@@ -185,14 +333,14 @@ template <typename T, typename U>
 void Lexer::Expect(const U& value) const {
     using namespace std::literals;
 
-    const T& res = Expect<T>();
+    const T res = Expect<T>();
     if (res.value != value) {
         throw LexerError("Another value expected"s);
     }
 }
 
 template <typename T>
-const T& Lexer::ExpectNext() {
+T Lexer::ExpectNext() {
     NextToken();
     return Expect<T>();
 }
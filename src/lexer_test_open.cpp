@@ -1,6 +1,11 @@
 #include "lexer.h"
+#include "scan.h"
 #include "test_runner_p.h"
 
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 #include <string>
 
@@ -40,6 +45,38 @@ void TestKeywords() {
     ASSERT_EQUAL(lexer.NextToken(), Token(token_type::False{}));
 }
 
+void TestKeywordLookalikes() {
+    const vector<pair<string, Token>> keywords = {
+        {"class"s, token_type::Class{}}, {"return"s, token_type::Return{}},
+        {"if"s, token_type::If{}},       {"else"s, token_type::Else{}},
+        {"def"s, token_type::Def{}},     {"print"s, token_type::Print{}},
+        {"and"s, token_type::And{}},     {"or"s, token_type::Or{}},
+        {"not"s, token_type::Not{}},     {"None"s, token_type::None{}},
+        {"True"s, token_type::True{}},   {"False"s, token_type::False{}},
+    };
+
+    for (const auto& [keyword, token] : keywords) {
+        // Ключевое слово распознаётся и вплотную к знакам препинания
+        istringstream input(keyword + "("s + keyword + ")"s);
+        Lexer lexer(input);
+        ASSERT_EQUAL(lexer.CurrentToken(), token);
+        ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Char{'('}));
+        ASSERT_EQUAL(lexer.NextToken(), token);
+
+        // Идентификаторы, отличающиеся от ключевого слова регистром, префиксом,
+        // суффиксом или одним символом, ключевыми словами не являются
+        string upper = keyword;
+        upper[0] = static_cast<char>(isupper(upper[0]) ? tolower(upper[0]) : toupper(upper[0]));
+        string changed = keyword;
+        changed.back() = changed.back() == 'x' ? 'y' : 'x';
+        for (const string& id : {upper, changed, keyword.substr(1), keyword + "_"s,
+                                 "_"s + keyword, keyword + keyword, keyword + "1"s}) {
+            istringstream id_input(id);
+            ASSERT_EQUAL(Lexer(id_input).CurrentToken(), Token(token_type::Id{id}));
+        }
+    }
+}
+
 void TestNumbers() {
     istringstream input("42 15 -53"s);
     Lexer lexer(input);
@@ -351,11 +388,177 @@ abc#
         ASSERT_EQUAL(lexer.NextToken(), Token(token_type::Eof{}));
     }
 }
+
+void TestTokenWindow() {
+    static_assert(sizeof(Token) <= 16);
+
+    // Лексер хранит токены только текущей строки программы
+    string program;
+    for (int i = 0; i < 1000; ++i) {
+        program += "x"s + to_string(i) + " = 'value "s + to_string(i) + "'\n"s;
+    }
+    istringstream input(program);
+    Lexer lexer(input);
+
+    size_t max_window = 0;
+    int lines = 0;
+    for (; !lexer.CurrentToken().Is<token_type::Eof>(); lexer.NextToken()) {
+        max_window = max(max_window, lexer.GetWindowSize());
+        if (const auto str = lexer.CurrentToken().TryAs<token_type::String>()) {
+            ASSERT_EQUAL(str->value, "value "s + to_string(lines));
+            ++lines;
+        }
+    }
+    ASSERT_EQUAL(lines, 1000);
+    ASSERT(max_window <= 5U);
+}
+
+void TestContiguousSource() {
+    const string program = "if x >= 10:\n  s = 'plain' + \"esc\\n\" # comment\n  print 2147483647"s;
+    const vector<Token> expected = {
+        token_type::If{}, token_type::Id{"x"s}, token_type::GreaterOrEq{},
+        token_type::Number{10}, token_type::Char{':'}, token_type::Newline{},
+        token_type::Indent{}, token_type::Id{"s"s}, token_type::Char{'='},
+        token_type::String{"plain"sv}, token_type::Char{'+'}, token_type::String{"esc\n"sv},
+        token_type::Newline{}, token_type::Print{}, token_type::Number{2147483647},
+        token_type::Newline{}, token_type::Eof{},
+    };
+
+    const string path = (filesystem::temp_directory_path() / "mython_lexer_test.my"s).string();
+    ofstream(path, ios::binary) << program;
+
+    for (int mode = 0; mode < 2; ++mode) {
+        Source source = mode == 0 ? Source::FromString(program) : Source::MapFile(path);
+        const string_view text = source.GetText();
+        Lexer lexer(std::move(source));
+        for (const Token& token : expected) {
+            ASSERT_EQUAL(lexer.CurrentToken(), token);
+            // Строки без escape-последовательностей не копируются из исходного текста
+            if (const auto str = lexer.CurrentToken().TryAs<token_type::String>();
+                    str && str->value == "plain"sv) {
+                ASSERT(str->value.data() > text.data()
+                       && str->value.data() < text.data() + text.size());
+            }
+            lexer.NextToken();
+        }
+    }
+    filesystem::remove(path);
+
+    ASSERT_THROWS(static_cast<void>(Source::MapFile(path)), runtime_error);
+    ASSERT_THROWS(Lexer(Source::FromString("x = 99999999999\n"s)), LexerError);
+    ASSERT_EQUAL(Lexer(Source()).CurrentToken(), Token(token_type::Eof{}));
+}
+
+// Лексемы программы. Содержимое строковых констант копируется в strings,
+// так как лексемы String ссылаются на память лексера
+struct Tokens {
+    vector<Token> tokens;
+    vector<string> strings;
+    bool error = false; // Разбор был прерван исключением LexerError
+
+    bool operator==(const Tokens& other) const {
+        return tokens == other.tokens && strings == other.strings && error == other.error;
+    }
+};
+
+// Разбирает program на лексемы в thread_count потоках
+Tokens Tokenize(const string& program, unsigned thread_count) {
+    Tokens result;
+    try {
+        Lexer lexer(Source::FromString(program), thread_count);
+        for (;; lexer.NextToken()) {
+            const Token& token = lexer.CurrentToken();
+            if (const auto str = token.TryAs<token_type::String>()) {
+                result.strings.emplace_back(str->value);
+                result.tokens.push_back(token_type::Char{'"'});
+            }
+            else {
+                result.tokens.push_back(token);
+            }
+            if (token.Is<token_type::Eof>()) {
+                return result;
+            }
+        }
+    }
+    catch (const LexerError&) {
+        result.error = true;
+    }
+    return result;
+}
+
+void TestParallelLexing() {
+    string program;
+    for (int i = 0; program.size() < 3 * Lexer::MIN_CHUNK_SIZE; ++i) {
+        const string n = to_string(i);
+        program += "class C"s + n + ":\n"s
+            + "  def m(x):\n"s
+            + "    # comment "s + n + "\n"s
+            + "\n"s
+            + "    if x >= "s + n + ":\n"s
+            + "      return 'text \\'"s + n + "\\'' + \"plain\"\n"s
+            + "    return None\n"s
+            + "print C"s + n + "().m(1)\n"s;
+    }
+    program += "  print 'last line without newline'"s;
+
+    const Tokens expected = Tokenize(program, 1);
+    ASSERT(!expected.error);
+    for (unsigned thread_count : {2U, 3U}) {
+        ASSERT(Tokenize(program, thread_count) == expected);
+    }
+
+    // Лексемы, предшествующие ошибке в середине текста, выдаются до исключения
+    const string broken = program.substr(0, program.size() / 2) + "\n x = 'unterminated\n"s
+        + program.substr(program.size() / 2);
+    const Tokens broken_expected = Tokenize(broken, 1);
+    ASSERT(broken_expected.error);
+    ASSERT(Tokenize(broken, 3) == broken_expected);
+}
+
+void TestScanKernels() {
+    static_assert(scan::Is('_', scan::ID_START) && scan::Is('7', scan::DIGIT | scan::ID));
+    static_assert(!scan::Is('7', scan::ID_START) && !scan::Is('\xC0', scan::ID));
+
+    // Результаты блочного поиска сравниваются с побайтовым для всех позиций искомого
+    // символа, в том числе в хвосте текста, не кратном размеру блока
+    const string alphabet = "Z_ '\\\n\r\xC0"s;
+    for (size_t size = 0; size <= 49; ++size) {
+        for (size_t stop = 0; stop <= size; ++stop) {
+            for (char filler : {'5', ' '}) {
+                for (char stop_char : alphabet) {
+                    string text(size, filler);
+                    if (stop < size) {
+                        text[stop] = stop_char;
+                    }
+                    const char* begin = text.data();
+                    const char* end = begin + text.size();
+                    auto expected = [&](auto predicate) {
+                        return find_if(begin, end, predicate);
+                    };
+
+                    ASSERT(scan::SkipSpaces(begin, end) == expected([](char ch) {
+                        return ch != ' ';
+                    }));
+                    ASSERT(scan::SkipIdChars(begin, end) == expected([](char ch) {
+                        return !isalnum(static_cast<unsigned char>(ch)) && ch != '_';
+                    }));
+                    ASSERT(scan::FindStringStop(begin, end, '\'') == expected([](char ch) {
+                        return ch == '\'' || ch == '\\' || ch == '\n' || ch == '\r';
+                    }));
+                    ASSERT(scan::FindLineEnd(begin, end) == expected([](char ch) {
+                        return ch == '\n';
+                    }));
+                }
+            }
+        }
+    }
+}
 }  // namespace
 
 void RunOpenLexerTests(TestRunner& tr) {
     RUN_TEST(tr, parse::TestSimpleAssignment);
     RUN_TEST(tr, parse::TestKeywords);
+    RUN_TEST(tr, parse::TestKeywordLookalikes);
     RUN_TEST(tr, parse::TestNumbers);
     RUN_TEST(tr, parse::TestIds);
     RUN_TEST(tr, parse::TestStrings);
@@ -367,6 +570,10 @@ void RunOpenLexerTests(TestRunner& tr) {
     RUN_TEST(tr, parse::TestMythonProgram);
     RUN_TEST(tr, parse::TestAlwaysEmitsNewlineAtTheEndOfNonemptyLine);
     RUN_TEST(tr, parse::TestCommentsAreIgnored);
+    RUN_TEST(tr, parse::TestTokenWindow);
+    RUN_TEST(tr, parse::TestContiguousSource);
+    RUN_TEST(tr, parse::TestScanKernels);
+    RUN_TEST(tr, parse::TestParallelLexing);
 }
 
 }  // namespace parse
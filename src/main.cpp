@@ -1,10 +1,18 @@
+#include "gc.h"
 #include "lexer.h"
+#include "optimizer.h"
 #include "parse.h"
+#include "program_cache.h"
 #include "runtime.h"
+#include "source.h"
 #include "statement.h"
 #include "test_runner_p.h"
+#include "vm.h"
 
+#include <charconv>
 #include <iostream>
+#include <optional>
+#include <string_view>
 
 using namespace std;
 
@@ -14,23 +22,89 @@ void RunOpenLexerTests(TestRunner& tr);
 
 namespace ast {
 void RunUnitTests(TestRunner& tr);
+void RunOptimizerTests(TestRunner& tr);
 }
 namespace runtime {
 void RunObjectHolderTests(TestRunner& tr);
 void RunObjectsTests(TestRunner& tr);
 }  // namespace runtime
 
+namespace bytecode {
+void RunVmTests(TestRunner& tr);
+}  // namespace bytecode
+
+namespace flat {
+void RunFlatTests(TestRunner& tr);
+}  // namespace flat
+
+namespace cache {
+void RunProgramCacheTests(TestRunner& tr);
+}  // namespace cache
+
 void TestParseProgram(TestRunner& tr);
 
 namespace {
 
-void RunMythonProgram(istream& input, ostream& output) {
-    parse::Lexer lexer(input);
-    auto program = ParseProgram(lexer);
+// Статистика исполнения программы
+struct ProgramStats {
+    runtime::GcStats gc;
+    runtime::MemoryStats memory;
+};
+
+// Параметры загрузки программы
+struct LoadOptions {
+    // Наибольшее количество потоков, разбирающих текст программы на лексемы
+    unsigned lexer_threads = 1;
+    // Откладывать ли разбор тел методов до их первого вызова
+    bool lazy_methods = false;
+    // Если не nullptr, программа загружается из образа кэша, а после разбора сохраняется в нём
+    const cache::ProgramCache* cache = nullptr;
+};
+
+// Разбирает программу с текстом source
+unique_ptr<runtime::Executable> LoadProgram(parse::Source source, const LoadOptions& options) {
+    if (options.cache != nullptr) {
+        if (auto program = options.cache->Load(source.GetText())) {
+            return program;
+        }
+    }
+
+    parse::Lexer lexer(std::move(source), options.lexer_threads);
+    auto program = ParseProgram(lexer, options.lazy_methods);
+    if (options.cache != nullptr) {
+        options.cache->Store(lexer.GetText(), *program);
+    }
+    return program;
+}
+
+// Исполняет программу с текстом source, ограничивая занимаемую ей память memory_limit байтами.
+// Если stats не nullptr, в него записывается статистика сборщика циклов и памяти.
+// Программа загружается с параметрами load_options
+void RunMythonProgram(parse::Source source, ostream& output,
+                      bytecode::Engine engine = bytecode::Engine::TreeWalking,
+                      bool optimize = true, ProgramStats* stats = nullptr,
+                      size_t memory_limit = runtime::MemoryAccount::UNLIMITED,
+                      const LoadOptions& load_options = {}) {
+    auto program = LoadProgram(std::move(source), load_options);
+    if (optimize) {
+        ast::Optimizer::Optimize(program);
+    }
+
+    runtime::GarbageCollector gc;
+    runtime::GcScope gc_scope(&gc);
 
     runtime::SimpleContext context{output};
+    context.GetMemory().SetLimit(memory_limit);
     runtime::Closure closure;
-    program->Execute(closure, context);
+    bytecode::RunProgram(*program, closure, context, engine);
+
+    // Циклы, удерживавшиеся глобальными переменными, освобождаются вместе с программой
+    closure.clear();
+    gc.Collect();
+    if (stats != nullptr) {
+        stats->gc = gc.GetStats();
+        stats->memory = context.GetMemory().GetStats();
+    }
 }
 
 void TestSimplePrints() {
@@ -45,7 +119,7 @@ print None
 )");
 
     ostringstream output;
-    RunMythonProgram(input, output);
+    RunMythonProgram(parse::Source::FromStream(input), output);
 
     ASSERT_EQUAL(output.str(), "57\n10 24 -8\nhello\nworld\nTrue False\n\nNone\n");
 }
@@ -64,7 +138,7 @@ print x, y
 )");
 
     ostringstream output;
-    RunMythonProgram(input, output);
+    RunMythonProgram(parse::Source::FromStream(input), output);
 
     ASSERT_EQUAL(output.str(), "57\nC++ black belt\nFalse\nNone False\n");
 }
@@ -73,7 +147,7 @@ void TestArithmetics() {
     istringstream input("print 1+2+3+4+5, 1*2*3*4*5, 1-2-3-4-5, 36/4/3, 2*5+10/2");
 
     ostringstream output;
-    RunMythonProgram(input, output);
+    RunMythonProgram(parse::Source::FromStream(input), output);
 
     ASSERT_EQUAL(output.str(), "15 120 -13 3 15\n");
 }
@@ -106,11 +180,90 @@ print y.value
 )");
 
     ostringstream output;
-    RunMythonProgram(input, output);
+    RunMythonProgram(parse::Source::FromStream(input), output);
 
     ASSERT_EQUAL(output.str(), "2\n3\n");
 }
 
+void TestReferenceCycles() {
+    istringstream input(R"(
+class Node:
+  def __init__(value):
+    self.value = value
+    self.me = self
+    self.next = None
+
+  def link(other):
+    self.next = other
+    other.next = self
+
+a = Node(1)
+b = Node(2)
+a.link(b)
+a = None
+b = None
+
+c = Node(3)
+print c.me.me.value
+)");
+
+    for (auto engine : {bytecode::Engine::TreeWalking, bytecode::Engine::Bytecode,
+                        bytecode::Engine::Flat}) {
+        ostringstream output;
+        ProgramStats stats;
+        input.clear();
+        input.seekg(0);
+        RunMythonProgram(parse::Source::FromStream(input), output, engine, true, &stats);
+
+        ASSERT_EQUAL(output.str(), "3\n");
+        ASSERT_EQUAL(stats.gc.objects_collected, 3U);
+        ASSERT(stats.gc.bytes_collected > 0);
+    }
+}
+
+void TestMemoryLimit() {
+    const string program = R"(
+class Node:
+  def __init__(value, next):
+    self.value = value
+    self.next = next
+
+class Builder:
+  def build(n):
+    return self.add(n, None)
+
+  def add(n, head):
+    if n == 0:
+      return head
+    return self.add(n - 1, Node('item ' + str(n), head))
+
+builder = Builder()
+head = builder.build(500)
+print head.value
+)"s;
+
+    for (auto engine : {bytecode::Engine::TreeWalking, bytecode::Engine::Bytecode,
+                        bytecode::Engine::Flat}) {
+        ProgramStats stats;
+        {
+            istringstream input(program);
+            ostringstream output;
+            RunMythonProgram(parse::Source::FromStream(input), output, engine, true, &stats);
+            ASSERT_EQUAL(output.str(), "item 1\n"s);
+        }
+        ASSERT(stats.memory.peak > 0);
+        ASSERT(stats.memory.total_allocated >= stats.memory.peak);
+        ASSERT_EQUAL(stats.memory.current, 0U);
+
+        // Программа, превысившая лимит, прерывается исключением
+        istringstream input(program);
+        ostringstream output;
+        ASSERT_THROWS(RunMythonProgram(parse::Source::FromStream(input), output, engine, true,
+                                       nullptr, stats.memory.peak / 2),
+                      runtime::MemoryLimitError);
+    }
+}
+
 void TestAll() {
     TestRunner tr;
     parse::RunOpenLexerTests(tr);
@@ -118,20 +271,116 @@ void TestAll() {
     runtime::RunObjectsTests(tr);
     ast::RunUnitTests(tr);
     TestParseProgram(tr);
+    ast::RunOptimizerTests(tr);
+    bytecode::RunVmTests(tr);
+    flat::RunFlatTests(tr);
+    cache::RunProgramCacheTests(tr);
 
     RUN_TEST(tr, TestSimplePrints);
     RUN_TEST(tr, TestAssignments);
     RUN_TEST(tr, TestArithmetics);
     RUN_TEST(tr, TestVariablesArePointers);
+    RUN_TEST(tr, TestReferenceCycles);
+    RUN_TEST(tr, TestMemoryLimit);
 }
 
 }  // namespace
 
-int main() {
+// Использование: interpretator [--engine=ast|bytecode|flat] [--no-optimize] [--lazy-methods]
+//                             [--gc-stats] [--memory-limit=<байт>] [--memory-stats]
+//                             [--lexer-threads=<число>] [--cache-dir=<каталог>]
+//                             [<файл программы>]
+// Если файл программы не указан, программа считывается из стандартного ввода.
+// Каталог кэша создаётся при первом сохранении образа программы
+int main(int argc, char* argv[]) {
+    bytecode::Engine engine = bytecode::Engine::TreeWalking;
+    bool optimize = true;
+    bool print_gc_stats = false;
+    bool print_memory_stats = false;
+    size_t memory_limit = runtime::MemoryAccount::UNLIMITED;
+    LoadOptions load_options;
+    constexpr string_view memory_limit_option = "--memory-limit="sv;
+    constexpr string_view lexer_threads_option = "--lexer-threads="sv;
+    constexpr string_view cache_dir_option = "--cache-dir="sv;
+    string program_path;
+    optional<cache::ProgramCache> program_cache;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (arg == "--engine=bytecode"sv) {
+            engine = bytecode::Engine::Bytecode;
+        }
+        else if (arg == "--engine=flat"sv) {
+            engine = bytecode::Engine::Flat;
+        }
+        else if (arg == "--engine=ast"sv) {
+            engine = bytecode::Engine::TreeWalking;
+        }
+        else if (arg == "--lazy-methods"sv) {
+            load_options.lazy_methods = true;
+        }
+        else if (arg == "--no-optimize"sv) {
+            optimize = false;
+        }
+        else if (arg == "--gc-stats"sv) {
+            print_gc_stats = true;
+        }
+        else if (arg == "--memory-stats"sv) {
+            print_memory_stats = true;
+        }
+        else if (arg.substr(0, memory_limit_option.size()) == memory_limit_option) {
+            const string_view value = arg.substr(memory_limit_option.size());
+            const auto [end, error] = from_chars(value.data(), value.data() + value.size(),
+                                                 memory_limit);
+            if (error != errc{} || end != value.data() + value.size()) {
+                std::cerr << "Invalid memory limit: "sv << value << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.substr(0, lexer_threads_option.size()) == lexer_threads_option) {
+            const string_view value = arg.substr(lexer_threads_option.size());
+            const auto [end, error] = from_chars(value.data(), value.data() + value.size(),
+                                                 load_options.lexer_threads);
+            if (error != errc{} || end != value.data() + value.size()
+                || load_options.lexer_threads == 0) {
+                std::cerr << "Invalid number of lexer threads: "sv << value << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.substr(0, cache_dir_option.size()) == cache_dir_option
+                 && arg.size() > cache_dir_option.size()) {
+            program_cache.emplace(string(arg.substr(cache_dir_option.size())));
+        }
+        else if (arg.substr(0, 2) != "--"sv && program_path.empty()) {
+            program_path = arg;
+        }
+        else {
+            std::cerr << "Unknown option: "sv << arg << std::endl;
+            return 1;
+        }
+    }
+
     try {
         TestAll();
 
-        RunMythonProgram(cin, cout);
+        ProgramStats stats;
+        // Файл программы отображается в память и разбирается лексером без копирования
+        parse::Source source = program_path.empty() ? parse::Source::FromStream(cin)
+                                                    : parse::Source::MapFile(program_path);
+        load_options.cache = program_cache ? &*program_cache : nullptr;
+        RunMythonProgram(std::move(source), cout, engine, optimize, &stats, memory_limit,
+                         load_options);
+        if (print_gc_stats) {
+            std::cerr << "gc: "sv << stats.gc.collections << " collections, "sv
+                      << stats.gc.objects_collected << " objects, "sv
+                      << stats.gc.bytes_collected << " bytes collected, max pause "sv
+                      << stats.gc.max_pause.count() << " ns, total pause "sv
+                      << stats.gc.total_pause.count() << " ns"sv << std::endl;
+        }
+        if (print_memory_stats) {
+            std::cerr << "memory: "sv << stats.memory.peak << " bytes peak, "sv
+                      << stats.memory.total_allocated << " bytes allocated, "sv
+                      << stats.memory.current << " bytes in use"sv << std::endl;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return 1;
@@ -0,0 +1,46 @@
+#include "memory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+thread_local MemoryAccount* current_account = nullptr;
+}  // namespace
+
+MemoryAccount::MemoryAccount(size_t limit)
+    : limit_(limit)
+{ /* do nothing */ }
+
+void MemoryAccount::Allocate(size_t bytes) {
+    if (bytes > limit_ || stats_.current > limit_ - bytes) {
+        throw MemoryLimitError("Memory limit of "s + to_string(limit_) + " bytes exceeded"s);
+    }
+    stats_.current += bytes;
+    stats_.total_allocated += bytes;
+    stats_.peak = max(stats_.peak, stats_.current);
+}
+
+void MemoryAccount::Release(size_t bytes) noexcept {
+    assert(bytes <= stats_.current);
+    stats_.current -= bytes;
+}
+
+MemoryAccount* MemoryAccount::GetCurrent() {
+    return current_account;
+}
+
+MemoryScope::MemoryScope(MemoryAccount* account)
+    : prev_(current_account) {
+    current_account = account;
+}
+
+MemoryScope::~MemoryScope() {
+    current_account = prev_;
+}
+
+}  // namespace runtime
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace runtime {
+
+// Исключение, выбрасываемое при превышении лимита памяти программы
+class MemoryLimitError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Статистика использования памяти программой
+struct MemoryStats {
+    size_t current = 0;         // Объём памяти, занятой в данный момент
+    size_t peak = 0;            // Наибольший объём одновременно занятой памяти
+    size_t total_allocated = 0; // Суммарный объём всех выделений
+};
+
+/*
+ * Счёт памяти, занимаемой объектами Mython: объектами в куче, содержимым строк и полями
+ * экземпляров классов. Выделения учитываются в счёте, установленном в потоке через
+ * MemoryScope. Выделение сверх лимита выбрасывает MemoryLimitError до изменения объекта,
+ * поэтому исключение можно перехватить и продолжить работу.
+ *
+ * Освобождение памяти возвращается в тот счёт, в котором было учтено выделение, независимо
+ * от счёта, установленного в момент освобождения. Поэтому счёт должен существовать,
+ * пока существуют учтённые в нём объекты
+ */
+class MemoryAccount {
+public:
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+    explicit MemoryAccount(size_t limit = UNLIMITED);
+
+    MemoryAccount(const MemoryAccount&) = delete;
+    MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+    // Устанавливает наибольший объём памяти, который может занимать программа
+    void SetLimit(size_t limit) {
+        limit_ = limit;
+    }
+
+    [[nodiscard]] size_t GetLimit() const {
+        return limit_;
+    }
+
+    [[nodiscard]] const MemoryStats& GetStats() const {
+        return stats_;
+    }
+
+    // Учитывает выделение bytes байт. Выбрасывает MemoryLimitError, если выделение
+    // превысит лимит; в этом случае счёт не изменяется
+    void Allocate(size_t bytes);
+    // Учитывает освобождение bytes байт, ранее учтённых методом Allocate
+    void Release(size_t bytes) noexcept;
+
+    // Возвращает счёт, установленный MemoryScope в текущем потоке, либо nullptr
+    [[nodiscard]] static MemoryAccount* GetCurrent();
+
+private:
+    size_t limit_;
+    MemoryStats stats_;
+};
+
+// Делает счёт текущим для своего потока на время своего существования
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryAccount* account);
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+    ~MemoryScope();
+
+private:
+    MemoryAccount* prev_;
+};
+
+/*
+ * Объём памяти, учтённый в счёте, который был текущим для потока при учёте. Объём
+ * возвращается в тот же счёт при разрушении. Копия учитывается заново в текущем счёте,
+ * при перемещении учтённый объём вместе со счётом переходит к новому владельцу
+ */
+class MemoryCharge {
+public:
+    MemoryCharge() = default;
+
+    explicit MemoryCharge(size_t bytes)
+        : account_(MemoryAccount::GetCurrent())
+        , bytes_(bytes) {
+        if (account_ != nullptr) {
+            account_->Allocate(bytes);
+        }
+    }
+
+    MemoryCharge(const MemoryCharge& other)
+        : MemoryCharge(other.bytes_) {
+    }
+
+    MemoryCharge(MemoryCharge&& other) noexcept
+        : account_(other.account_)
+        , bytes_(other.bytes_) {
+        other.bytes_ = 0;
+    }
+
+    MemoryCharge& operator=(const MemoryCharge& other) {
+        Resize(other.bytes_);
+        return *this;
+    }
+
+    MemoryCharge& operator=(MemoryCharge&& other) noexcept {
+        if (this != &other) {
+            Refund();
+            account_ = other.account_;
+            bytes_ = other.bytes_;
+            other.bytes_ = 0;
+        }
+        return *this;
+    }
+
+    ~MemoryCharge() {
+        Refund();
+    }
+
+    // Изменяет учтённый объём до bytes. При превышении лимита объём не изменяется.
+    // Пустой объём учитывается заново в текущем счёте потока
+    void Resize(size_t bytes) {
+        if (bytes_ == 0) {
+            account_ = MemoryAccount::GetCurrent();
+        }
+        if (account_ != nullptr) {
+            if (bytes > bytes_) {
+                account_->Allocate(bytes - bytes_);
+            }
+            else {
+                account_->Release(bytes_ - bytes);
+            }
+        }
+        bytes_ = bytes;
+    }
+
+    [[nodiscard]] size_t GetBytes() const {
+        return bytes_;
+    }
+
+private:
+    void Refund() noexcept {
+        if (account_ != nullptr) {
+            account_->Release(bytes_);
+        }
+    }
+
+    MemoryAccount* account_ = nullptr; // Счёт, в котором учтён объём
+    size_t bytes_ = 0;
+};
+
+}  // namespace runtime
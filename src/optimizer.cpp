@@ -0,0 +1,185 @@
+#include "optimizer.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace ast {
+
+using runtime::Closure;
+using runtime::ObjectHolder;
+
+namespace {
+// Возвращает true, если узел - константа: число, строка, логическое значение либо None
+bool IsConstant(const Statement& node) {
+    return dynamic_cast<const NumericConst*>(&node) != nullptr
+        || dynamic_cast<const StringConst*>(&node) != nullptr
+        || dynamic_cast<const BoolConst*>(&node) != nullptr
+        || dynamic_cast<const None*>(&node) != nullptr;
+}
+
+// Возвращает значение константного узла
+ObjectHolder EvaluateConstant(Statement& node) {
+    Closure closure;
+    runtime::DummyContext context;
+    return node.Execute(closure, context);
+}
+
+// Создаёт узел-константу со значением value либо возвращает nullptr,
+// если значение не представимо константой
+unique_ptr<Statement> MakeConstant(const ObjectHolder& value) {
+    switch (value.GetType()) {
+    case runtime::ObjectType::None:
+        return make_unique<None>();
+    case runtime::ObjectType::Number:
+        return make_unique<NumericConst>(*value.TryAs<runtime::Number>());
+    case runtime::ObjectType::String:
+        return make_unique<StringConst>(*value.TryAs<runtime::String>());
+    case runtime::ObjectType::Bool:
+        return make_unique<BoolConst>(*value.TryAs<runtime::Bool>());
+    default:
+        return nullptr;
+    }
+}
+}  // namespace
+
+void Optimizer::Optimize(unique_ptr<Statement>& program) {
+    Optimizer optimizer;
+    optimizer.OptimizeNode(program, true);
+}
+
+void Optimizer::OptimizeNode(unique_ptr<Statement>& node, bool value_used) {
+    Statement* raw = node.get();
+
+    if (auto* assign = dynamic_cast<Assignment*>(raw)) {
+        OptimizeNode(assign->rv_, true);
+    }
+    else if (auto* field_assign = dynamic_cast<FieldAssignment*>(raw)) {
+        OptimizeNode(field_assign->rv_, true);
+    }
+    else if (auto* print = dynamic_cast<Print*>(raw)) {
+        for (auto& arg : print->args_) {
+            OptimizeNode(arg, true);
+        }
+    }
+    else if (auto* call = dynamic_cast<MethodCall*>(raw)) {
+        OptimizeNode(call->object_, true);
+        for (auto& arg : call->args_) {
+            OptimizeNode(arg, true);
+        }
+    }
+    else if (auto* new_inst = dynamic_cast<NewInstance*>(raw)) {
+        for (auto& arg : new_inst->args_) {
+            OptimizeNode(arg, true);
+        }
+    }
+    else if (auto* unary = dynamic_cast<UnaryOperation*>(raw)) {
+        OptimizeNode(unary->argument_, true);
+        FoldConstants(node, {unary->argument_.get()});
+    }
+    else if (auto* binary = dynamic_cast<BinaryOperation*>(raw)) {
+        OptimizeNode(binary->lhs_, true);
+        OptimizeNode(binary->rhs_, true);
+
+        // Результат or с истинным и and с ложным левым операндом известен заранее
+        const bool is_or = dynamic_cast<Or*>(raw) != nullptr;
+        if ((is_or || dynamic_cast<And*>(raw) != nullptr) && IsConstant(*binary->lhs_)) {
+            ObjectHolder lhs = EvaluateConstant(*binary->lhs_);
+            if (lhs && runtime::IsTrue(lhs) == is_or) {
+                node = make_unique<BoolConst>(is_or);
+                return;
+            }
+        }
+        FoldConstants(node, {binary->lhs_.get(), binary->rhs_.get()});
+    }
+    else if (auto* compound = dynamic_cast<Compound*>(raw)) {
+        OptimizeCompound(node, *compound, value_used);
+    }
+    else if (auto* method_body = dynamic_cast<MethodBody*>(raw)) {
+        OptimizeNode(method_body->body_, true);
+    }
+    else if (auto* ret = dynamic_cast<Return*>(raw)) {
+        OptimizeNode(ret->statement_, true);
+    }
+    else if (auto* if_else = dynamic_cast<IfElse*>(raw)) {
+        OptimizeIfElse(node, *if_else, value_used);
+    }
+    else if (auto* program = dynamic_cast<Program*>(raw)) {
+        OptimizeNode(program->root_, value_used);
+    }
+    else if (auto* class_def = dynamic_cast<ClassDefinition*>(raw)) {
+        class_def->GetClass().TryAs<runtime::Class>()->TransformMethodBodies(
+            [](unique_ptr<Statement>& body) {
+                // Тела, разбор которых отложен, оптимизируются после завершения Optimize
+                Optimizer optimizer;
+                optimizer.OptimizeNode(body, true);
+            });
+    }
+}
+
+void Optimizer::OptimizeCompound(unique_ptr<Statement>& node, Compound& compound,
+                                 bool value_used) {
+    // Значения инструкций внутри Compound не используются, поэтому вложенные Compound
+    // встраиваются в текущий. Результат return передаётся вверх так же, как и до встраивания
+    vector<unique_ptr<Statement>> statements;
+    statements.reserve(compound.statements_.size());
+    for (auto& stmt : compound.statements_) {
+        OptimizeNode(stmt, false);
+        if (auto* nested = dynamic_cast<Compound*>(stmt.get())) {
+            for (auto& nested_stmt : nested->statements_) {
+                statements.push_back(std::move(nested_stmt));
+            }
+        }
+        else {
+            statements.push_back(std::move(stmt));
+        }
+    }
+    compound.statements_ = std::move(statements);
+
+    // Compound возвращает None, поэтому заменить его единственной инструкцией
+    // можно, только если значение не используется
+    if (!value_used && compound.statements_.size() == 1) {
+        node = std::move(compound.statements_.front());
+    }
+}
+
+void Optimizer::OptimizeIfElse(unique_ptr<Statement>& node, IfElse& if_else, bool value_used) {
+    OptimizeNode(if_else.condition_, true);
+    OptimizeNode(if_else.if_body_, value_used);
+    if (if_else.else_body_) {
+        OptimizeNode(if_else.else_body_, value_used);
+    }
+
+    if (!IsConstant(*if_else.condition_)) {
+        return;
+    }
+
+    // Инструкция if возвращает значение выполненной ветки либо None
+    unique_ptr<Statement> branch = runtime::IsTrue(EvaluateConstant(*if_else.condition_))
+        ? std::move(if_else.if_body_)
+        : std::move(if_else.else_body_);
+    node = branch ? std::move(branch) : make_unique<None>();
+}
+
+void Optimizer::FoldConstants(unique_ptr<Statement>& node,
+                              initializer_list<const Statement*> operands) {
+    for (const Statement* operand : operands) {
+        if (!IsConstant(*operand)) {
+            return;
+        }
+    }
+
+    ObjectHolder value;
+    try {
+        value = EvaluateConstant(*node);
+    } catch (const runtime_error&) {
+        // Ошибка будет выброшена при выполнении программы
+        return;
+    }
+
+    if (auto constant = MakeConstant(value)) {
+        node = std::move(constant);
+    }
+}
+
+}  // namespace ast
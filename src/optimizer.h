@@ -0,0 +1,35 @@
+#pragma once
+
+#include "statement.h"
+
+#include <initializer_list>
+#include <memory>
+
+namespace ast {
+
+/*
+Оптимизатор AST, преобразующий программу между разбором и выполнением:
+- вычисляет арифметические операции, конкатенацию строк, сравнения, логические операции
+  и операцию str над константами (в том числе отрицательные числа вида Mult(x, -1));
+- заменяет инструкцию if с константным условием выполняемой веткой;
+- встраивает вложенные Compound в объемлющий и заменяет Compound из одной инструкции
+  этой инструкцией, если значение Compound не используется.
+Операции, выполнение которых привело бы к ошибке (например, деление на ноль), не вычисляются
+и сообщают об ошибке при выполнении программы
+*/
+class Optimizer {
+public:
+    // Оптимизирует программу program вместе с телами методов объявленных в ней классов
+    static void Optimize(std::unique_ptr<Statement>& program);
+
+private:
+    // Оптимизирует узел node. value_used - используется ли значение, которое вернёт узел
+    void OptimizeNode(std::unique_ptr<Statement>& node, bool value_used);
+    void OptimizeCompound(std::unique_ptr<Statement>& node, Compound& compound, bool value_used);
+    void OptimizeIfElse(std::unique_ptr<Statement>& node, IfElse& if_else, bool value_used);
+    // Заменяет узел node константой, если все его операнды operands - константы
+    void FoldConstants(std::unique_ptr<Statement>& node,
+                       std::initializer_list<const Statement*> operands);
+};
+
+}  // namespace ast
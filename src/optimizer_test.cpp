@@ -0,0 +1,133 @@
+#include "lexer.h"
+#include "optimizer.h"
+#include "parse.h"
+#include "test_runner_p.h"
+
+using namespace std;
+
+namespace ast {
+
+namespace {
+
+unique_ptr<Statement> ParseAndOptimize(const string& program) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+    Optimizer::Optimize(tree);
+    return tree;
+}
+
+string Run(const string& program, bool optimize) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer);
+    if (optimize) {
+        Optimizer::Optimize(tree);
+    }
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    tree->Execute(closure, context);
+    return context.output.str();
+}
+
+// Проверяет, что программа выводит expected с оптимизацией и без неё
+void AssertSameOutput(const string& program, const string& expected) {
+    ASSERT_EQUAL(Run(program, false), expected);
+    ASSERT_EQUAL(Run(program, true), expected);
+}
+
+// Возвращает инструкции программы, построенной ParseProgram
+const vector<unique_ptr<Statement>>& GetProgramStatements(const Statement& program) {
+    const auto& root = dynamic_cast<const Program&>(program).GetRoot();
+    return dynamic_cast<const Compound&>(root).GetStatements();
+}
+
+void TestConstantFolding() {
+    auto program = ParseAndOptimize(
+        "x = 2*5+10/2\ny = -3\nz = 'a' + 'b' + str(1 < 2)\nw = not 0 and 1 >= 1\n"s);
+    const auto& statements = GetProgramStatements(*program);
+    ASSERT_EQUAL(statements.size(), 4U);
+
+    auto get_rvalue = [&statements](size_t i) -> const Statement& {
+        return dynamic_cast<const Assignment&>(*statements[i]).GetRvalue();
+    };
+    const auto* x = dynamic_cast<const NumericConst*>(&get_rvalue(0));
+    ASSERT(x != nullptr && x->GetValue().GetValue() == 15);
+    const auto* y = dynamic_cast<const NumericConst*>(&get_rvalue(1));
+    ASSERT(y != nullptr && y->GetValue().GetValue() == -3);
+    const auto* z = dynamic_cast<const StringConst*>(&get_rvalue(2));
+    ASSERT(z != nullptr && z->GetValue().GetValue() == "abTrue"s);
+    const auto* w = dynamic_cast<const BoolConst*>(&get_rvalue(3));
+    ASSERT(w != nullptr && w->GetValue().GetValue());
+}
+
+void TestErrorsAreNotFolded() {
+    auto program = ParseAndOptimize("x = 1 / 0\ny = 1 + 'a'\nz = None or x\n"s);
+    for (const auto& statement : GetProgramStatements(*program)) {
+        const auto& rvalue = dynamic_cast<const Assignment&>(*statement).GetRvalue();
+        ASSERT(dynamic_cast<const NumericConst*>(&rvalue) == nullptr);
+    }
+    ASSERT_THROWS(Run("print 1 / 0\n"s, true), runtime_error);
+    ASSERT_THROWS(Run("print None and True\n"s, true), runtime_error);
+}
+
+void TestDeadBranches() {
+    auto program = ParseAndOptimize(R"(
+if True:
+  print 'yes'
+else:
+  print 'no'
+if 1 > 2:
+  print 'never'
+)"s);
+    const auto& statements = GetProgramStatements(*program);
+    ASSERT_EQUAL(statements.size(), 2U);
+    ASSERT(dynamic_cast<const Print*>(statements[0].get()) != nullptr);
+    ASSERT(dynamic_cast<const None*>(statements[1].get()) != nullptr);
+
+    AssertSameOutput(R"(
+x = 5
+if x > 2 and True:
+  print 'big'
+if False or x:
+  print 'truthy'
+if None:
+  print 'never'
+else:
+  print 'None is false'
+)"s,
+                     "big\ntruthy\nNone is false\n"s);
+}
+
+void TestMethodSemanticsArePreserved() {
+    AssertSameOutput(R"(
+class Test:
+  def assign_only():
+    x = 1
+
+  def early_return(flag):
+    if True:
+      if flag:
+        return 'early'
+    return 'late'
+
+  def constant():
+    return 2 * 21
+
+t = Test()
+print t.assign_only(), t.early_return(True), t.early_return(False), t.constant()
+)"s,
+                     "None early late 42\n"s);
+}
+
+}  // namespace
+
+void RunOptimizerTests(TestRunner& tr) {
+    RUN_TEST(tr, ast::TestConstantFolding);
+    RUN_TEST(tr, ast::TestErrorsAreNotFolded);
+    RUN_TEST(tr, ast::TestDeadBranches);
+    RUN_TEST(tr, ast::TestMethodSemanticsArePreserved);
+}
+
+}  // namespace ast
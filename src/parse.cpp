@@ -3,24 +3,80 @@
 #include "lexer.h"
 #include "statement.h"
 
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
 using namespace std;
 
 namespace TokenType = parse::token_type;
 
 namespace {
 bool operator==(const parse::Token& token, char c) {
-    const auto* p = token.TryAs<TokenType::Char>();
-    return p != nullptr && p->value == c;
+    const auto p = token.TryAs<TokenType::Char>();
+    return p && p->value == c;
 }
 
 bool operator!=(const parse::Token& token, char c) {
     return !(token == c);
 }
 
+// Класс, объявленный в программе
+struct DeclaredClass {
+    const runtime::Class* cls;
+    size_t index; // Номер класса в порядке объявления
+};
+
+// Классы программы по именам. Классами владеют узлы ClassDefinition программы
+using ClassTable = unordered_map<runtime::Symbol, DeclaredClass>;
+
+/*
+ * Тело метода, текст которого сохранён при разборе программы и разбирается
+ * при первом вызове метода. Разбор видит те же классы, что и разбор при загрузке:
+ * объявленные в программе до метода
+ */
+class DeferredMethodBody : public runtime::DeferredBody {
+public:
+    // text - строки тела метода, indent - отступ строки с объявлением метода
+    DeferredMethodBody(std::string text, int indent, std::shared_ptr<runtime::Arena> arena,
+                       std::shared_ptr<ClassTable> classes, size_t visible_classes)
+        : text_(std::move(text))
+        , indent_(indent)
+        , arena_(std::move(arena))
+        , classes_(std::move(classes))
+        , visible_classes_(visible_classes)
+    { /* do nothing */ }
+
+    void Parse(runtime::Method& method) const override;
+
+private:
+    std::string text_;
+    int indent_;
+    std::shared_ptr<runtime::Arena> arena_;
+    std::shared_ptr<ClassTable> classes_;
+    size_t visible_classes_; // Количество классов, объявленных до метода
+};
+
 class Parser {
 public:
-    explicit Parser(parse::Lexer& lexer)
-        : lexer_(lexer) {
+    // Тела методов классов размещаются в арене arena, которую классы удерживают.
+    // Если lazy_methods равен true, разбор тел методов откладывается до их первого вызова
+    Parser(parse::Lexer& lexer, std::shared_ptr<runtime::Arena> arena, bool lazy_methods = false)
+        : lexer_(lexer)
+        , declared_classes_(std::make_shared<ClassTable>())
+        , arena_(std::move(arena))
+        , lazy_methods_(lazy_methods) {
+    }
+
+    // Создаёт парсер отложенного тела метода, которому видны первые visible_classes
+    // классов таблицы classes
+    Parser(parse::Lexer& lexer, std::shared_ptr<runtime::Arena> arena,
+           std::shared_ptr<ClassTable> classes, size_t visible_classes)
+        : lexer_(lexer)
+        , declared_classes_(std::move(classes))
+        , visible_classes_(visible_classes)
+        , arena_(std::move(arena)) {
     }
 
     // Program -> eps
@@ -34,13 +90,42 @@ public:
         return result;
     }
 
+    // Разбирает тело метода method, разбор которого был отложен. Текст тела начинается
+    // с indent + 1 отступов: indent - отступ строки с объявлением метода
+    void ParseDeferredMethod(runtime::Method& method, int indent) {
+        for (int i = 0; i < indent; ++i) {
+            lexer_.Expect<TokenType::Indent>();
+            lexer_.NextToken();
+        }
+
+        MethodScope scope = MakeMethodScope(method);
+        method_scope_ = &scope;
+        auto body = std::make_unique<ast::MethodBody>(ParseBlock());
+        method_scope_ = nullptr;
+
+        for (int i = 0; i < indent; ++i) {
+            lexer_.Expect<TokenType::Dedent>();
+            lexer_.NextToken();
+        }
+        lexer_.Expect<TokenType::Eof>();
+
+        method.body = std::move(body);
+        method.frame_size = scope.size();
+    }
+
 private:
-    // Suite -> NEWLINE INDENT (Statement)+ DEDENT
+    // Suite -> NEWLINE Block
     unique_ptr<ast::Statement> ParseSuite()  // NOLINT
     {
         lexer_.Expect<TokenType::Newline>();
-        lexer_.ExpectNext<TokenType::Indent>();
+        lexer_.NextToken();
+        return ParseBlock();
+    }
 
+    // Block -> INDENT (Statement)+ DEDENT
+    unique_ptr<ast::Statement> ParseBlock()  // NOLINT
+    {
+        lexer_.Expect<TokenType::Indent>();
         lexer_.NextToken();
 
         auto result = make_unique<ast::Compound>();
@@ -76,7 +161,22 @@ private:
             lexer_.ExpectNext<TokenType::Char>(':');
             lexer_.NextToken();
 
-            m.body = std::make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
+            MethodScope scope = MakeMethodScope(m);
+
+            // Отложенное тело сохраняется текстом, лексер переходит к строке за ним
+            optional<parse::Lexer::SkippedBlock> block;
+            if (lazy_methods_ && (block = lexer_.SkipBlock())) {
+                m.deferred_body = make_unique<DeferredMethodBody>(
+                    string(block->text), block->indent, arena_, declared_classes_,
+                    declared_classes_->size());
+                lexer_.NextToken();
+            }
+            else {
+                MethodScope* enclosing_scope = exchange(method_scope_, &scope);
+                m.body = std::make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
+                method_scope_ = enclosing_scope;
+                m.frame_size = scope.size();
+            }
 
             result.push_back(std::move(m));
         }
@@ -86,7 +186,7 @@ private:
     // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
     unique_ptr<ast::Statement> ParseClassDefinition()  // NOLINT
     {
-        string class_name = lexer_.Expect<TokenType::Id>().value;
+        runtime::Symbol class_name = lexer_.Expect<TokenType::Id>().value;
 
         lexer_.NextToken();
 
@@ -96,11 +196,10 @@ private:
             lexer_.ExpectNext<TokenType::Char>(')');
             lexer_.NextToken();
 
-            auto it = declared_classes_.find(name);
-            if (it == declared_classes_.end()) {
+            base_class = FindClass(name);
+            if (base_class == nullptr) {
                 throw ParseError("Base class "s + name + " not found for class "s + class_name);
             }
-            base_class = static_cast<const runtime::Class*>(it->second.Get());  // NOLINT
         }
 
         lexer_.Expect<TokenType::Char>(':');
@@ -112,20 +211,18 @@ private:
         lexer_.Expect<TokenType::Dedent>();
         lexer_.NextToken();
 
-        auto [it, inserted] = declared_classes_.insert({
-            class_name,
-            runtime::ObjectHolder::Own(runtime::Class(class_name, std::move(methods), base_class)),
-        });
-
-        if (!inserted) {
+        auto cls = runtime::ObjectHolder::Own(
+            runtime::Class(class_name.GetName(), std::move(methods), base_class, arena_));
+        const DeclaredClass declared{cls.TryAs<runtime::Class>(), declared_classes_->size()};
+        if (!declared_classes_->emplace(class_name, declared).second) {
             throw ParseError("Class "s + class_name + " already exists"s);
         }
 
-        return make_unique<ast::ClassDefinition>(it->second);
+        return make_unique<ast::ClassDefinition>(std::move(cls));
     }
 
-    vector<string> ParseDottedIds() {
-        vector<string> result(1, lexer_.Expect<TokenType::Id>().value);
+    vector<runtime::Symbol> ParseDottedIds() {
+        vector<runtime::Symbol> result(1, lexer_.Expect<TokenType::Id>().value);
 
         while (lexer_.NextToken() == '.') {
             result.push_back(lexer_.ExpectNext<TokenType::Id>().value);
@@ -139,17 +236,20 @@ private:
     unique_ptr<ast::Statement> ParseAssignmentOrCall() {
         lexer_.Expect<TokenType::Id>();
 
-        vector<string> id_list = ParseDottedIds();
-        string last_name = id_list.back();
+        vector<runtime::Symbol> id_list = ParseDottedIds();
+        runtime::Symbol last_name = id_list.back();
         id_list.pop_back();
 
         if (lexer_.CurrentToken() == '=') {
             lexer_.NextToken();
 
             if (id_list.empty()) {
+                if (auto slot = ResolveSlot(last_name)) {
+                    return make_unique<ast::Assignment>(std::move(last_name), ParseTest(), *slot);
+                }
                 return make_unique<ast::Assignment>(std::move(last_name), ParseTest());
             }
-            return make_unique<ast::FieldAssignment>(ast::VariableValue{std::move(id_list)},
+            return make_unique<ast::FieldAssignment>(MakeVariableValue(std::move(id_list)),
                                                      std::move(last_name), ParseTest());
         }
         lexer_.Expect<TokenType::Char>('(');
@@ -166,8 +266,9 @@ private:
         lexer_.Expect<TokenType::Char>(')');
         lexer_.NextToken();
 
-        return make_unique<ast::MethodCall>(make_unique<ast::VariableValue>(std::move(id_list)),
-                                            std::move(last_name), std::move(args));
+        return make_unique<ast::MethodCall>(
+            make_unique<ast::VariableValue>(MakeVariableValue(std::move(id_list))),
+            std::move(last_name), std::move(args));
     }
 
     // Expr -> Adder ['+'/'-' Adder]*
@@ -226,13 +327,13 @@ private:
             lexer_.NextToken();
             return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
         }
-        if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
+        if (const auto num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
             int result = num->value;
             lexer_.NextToken();
             return make_unique<ast::NumericConst>(result);
         }
-        if (const auto* str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
-            string result = str->value;
+        if (const auto str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
+            string result(str->value);
             lexer_.NextToken();
             return make_unique<ast::StringConst>(std::move(result));
         }
@@ -253,7 +354,7 @@ private:
     }
 
     std::unique_ptr<ast::Statement> ParseDottedIdsInMultExpr() {
-        vector<string> names = ParseDottedIds();
+        vector<runtime::Symbol> names = ParseDottedIds();
 
         if (lexer_.CurrentToken() == '(') {
             // various calls
@@ -269,12 +370,11 @@ private:
 
             if (!names.empty()) {
                 return make_unique<ast::MethodCall>(
-                    make_unique<ast::VariableValue>(std::move(names)), std::move(method_name),
-                    std::move(args));
+                    make_unique<ast::VariableValue>(MakeVariableValue(std::move(names))),
+                    std::move(method_name), std::move(args));
             }
-            if (auto it = declared_classes_.find(method_name); it != declared_classes_.end()) {
-                return make_unique<ast::NewInstance>(
-                    static_cast<const runtime::Class&>(*it->second), std::move(args));  // NOLINT
+            if (const runtime::Class* cls = FindClass(method_name)) {
+                return make_unique<ast::NewInstance>(*cls, std::move(args));
             }
             if (method_name == "str"sv) {
                 if (args.size() != 1) {
@@ -284,7 +384,32 @@ private:
             }
             throw ParseError("Unknown call to "s + method_name + "()"s);
         }
-        return make_unique<ast::VariableValue>(std::move(names));
+        return make_unique<ast::VariableValue>(MakeVariableValue(std::move(names)));
+    }
+
+    // Возвращает класс name, объявленный до разбираемого места программы, либо nullptr
+    const runtime::Class* FindClass(runtime::Symbol name) const {
+        auto it = declared_classes_->find(name);
+        if (it == declared_classes_->end() || it->second.index >= visible_classes_) {
+            return nullptr;
+        }
+        return it->second.cls;
+    }
+
+    // Возвращает слот переменной name в кадре разбираемого метода, назначая новый слот
+    // при первом упоминании. Вне методов переменные не имеют слотов
+    optional<size_t> ResolveSlot(runtime::Symbol name) {
+        if (method_scope_ == nullptr) {
+            return nullopt;
+        }
+        return method_scope_->emplace(name, method_scope_->size()).first->second;
+    }
+
+    ast::VariableValue MakeVariableValue(vector<runtime::Symbol> dotted_ids) {
+        if (auto slot = ResolveSlot(dotted_ids.front())) {
+            return ast::VariableValue(std::move(dotted_ids), *slot);
+        }
+        return ast::VariableValue(std::move(dotted_ids));
     }
 
     vector<unique_ptr<ast::Statement>> ParseTestList()  // NOLINT
@@ -365,32 +490,32 @@ private:
 
         if (tok == '<') {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Less, std::move(result),
+            return make_unique<ast::Comparison>(runtime::Comparator::Less, std::move(result),
                                                 ParseExpression());
         }
         if (tok == '>') {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Greater, std::move(result),
+            return make_unique<ast::Comparison>(runtime::Comparator::Greater, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::Eq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::Equal, std::move(result),
+            return make_unique<ast::Comparison>(runtime::Comparator::Equal, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::NotEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::NotEqual, std::move(result),
+            return make_unique<ast::Comparison>(runtime::Comparator::NotEqual, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::LessOrEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result),
+            return make_unique<ast::Comparison>(runtime::Comparator::LessOrEqual, std::move(result),
                                                 ParseExpression());
         }
         if (tok.Is<TokenType::GreaterOrEq>()) {
             lexer_.NextToken();
-            return make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
+            return make_unique<ast::Comparison>(runtime::Comparator::GreaterOrEqual, std::move(result),
                                                 ParseExpression());
         }
         return result;
@@ -423,6 +548,10 @@ private:
         const auto& tok = lexer_.CurrentToken();
 
         if (tok.Is<TokenType::Return>()) {
+            // Вне тела метода return некуда вернуть значение
+            if (method_scope_ == nullptr) {
+                throw ParseError("return outside of method"s);
+            }
             lexer_.NextToken();
             return make_unique<ast::Return>(ParseTest());
         }
@@ -437,12 +566,48 @@ private:
         return ParseAssignmentOrCall();
     }
 
+    // Соответствие имён переменных метода слотам его кадра
+    using MethodScope = unordered_map<runtime::Symbol, size_t>;
+
+    // Возвращает область видимости метода method, в которой слот 0 занимает self,
+    // а за ним в порядке объявления следуют параметры
+    static MethodScope MakeMethodScope(const runtime::Method& method) {
+        MethodScope scope{{"self"s, 0}};
+        for (runtime::Symbol param : method.formal_params) {
+            if (!scope.emplace(param, scope.size()).second) {
+                throw ParseError("Duplicate parameter "s + param + " in method "s + method.name);
+            }
+        }
+        return scope;
+    }
+
     parse::Lexer& lexer_;
-    runtime::Closure declared_classes_;
+    std::shared_ptr<ClassTable> declared_classes_;
+    // Количество классов таблицы, видимых из разбираемого текста
+    size_t visible_classes_ = numeric_limits<size_t>::max();
+    MethodScope* method_scope_ = nullptr; // Область видимости разбираемого метода
+    std::shared_ptr<runtime::Arena> arena_; // Арена, в которой размещаются узлы AST
+    bool lazy_methods_ = false; // Откладывать ли разбор тел методов
 };
 
+void DeferredMethodBody::Parse(runtime::Method& method) const {
+    // Узлы тела размещаются в арене программы. Память, занятая текстом программы,
+    // не относится к памяти исполняемой программы и не учитывается в её счёте
+    runtime::ArenaScope arena_scope(arena_.get());
+    runtime::MemoryScope memory_scope(nullptr);
+    parse::Lexer lexer(parse::Source::FromString(text_));
+    Parser(lexer, arena_, classes_, visible_classes_).ParseDeferredMethod(method, indent_);
+}
+
 }  // namespace
 
-unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer) {
-    return Parser{lexer}.ParseProgram();
+unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer, bool lazy_methods) {
+    auto arena = make_shared<runtime::Arena>();
+    unique_ptr<ast::Statement> root;
+    {
+        runtime::ArenaScope arena_scope(arena.get());
+        root = Parser{lexer, arena, lazy_methods}.ParseProgram();
+    }
+    // Сама программа владеет ареной, поэтому размещается вне её
+    return make_unique<ast::Program>(std::move(arena), std::move(root));
 }
@@ -15,4 +15,8 @@ struct ParseError : std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
-std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer);
+// Разбирает программу и возвращает объект ast::Program, узлы которого размещены в его арене.
+// Если lazy_methods равен true, тела методов разбираются при первом вызове метода:
+// при загрузке проверяются только объявления методов, а ошибки в телах
+// обнаруживаются при вызове
+std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer, bool lazy_methods = false);
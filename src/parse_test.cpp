@@ -1,4 +1,5 @@
 #include "lexer.h"
+#include "optimizer.h"
 #include "parse.h"
 #include "statement.h"
 #include "test_runner_p.h"
@@ -7,10 +8,11 @@ using namespace std;
 
 namespace parse {
 
-unique_ptr<ast::Statement> ParseProgramFromString(const string& program) {
+unique_ptr<ast::Statement> ParseProgramFromString(const string& program,
+                                                  bool lazy_methods = false) {
     istringstream is(program);
     parse::Lexer lexer(is);
-    return ParseProgram(lexer);
+    return ParseProgram(lexer, lazy_methods);
 }
 
 void TestSimpleProgram() {
@@ -266,6 +268,206 @@ x = X(xh)
     ASSERT_EQUAL(xh->Fields().at("x"s).Get(), closure.at("x"s).Get());
 }
 
+void TestMethodLocalVariables() {
+    const string program = R"(
+class Counter:
+  def __init__(start):
+    self.value = start
+
+  def add(delta):
+    old = self.value
+    value = old + delta
+    self.value = value
+    return old
+
+  def broken():
+    if False:
+      x = 1
+    return x
+
+value = 100
+c = Counter(1)
+print c.add(2), c.add(3), c.value, value
+)"s;
+
+    runtime::DummyContext context;
+
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program);
+    tree->Execute(closure, context);
+
+    ASSERT_EQUAL(context.output.str(), "1 3 6 100\n"s);
+    // Локальные переменные методов не попадают в глобальную таблицу символов
+    ASSERT_EQUAL(closure.count("old"s), 0U);
+
+    // Чтение локальной переменной до присваивания - ошибка времени выполнения
+    auto* counter = closure.at("c"s).TryAs<runtime::ClassInstance>();
+    ASSERT_THROWS(counter->Call("broken"s, {}, context), std::runtime_error);
+}
+
+void TestDuplicateParameters() {
+    ASSERT_THROWS(ParseProgramFromString("class A:\n  def f(x, x):\n    return x\n"s),
+                  ParseError);
+    ASSERT_THROWS(ParseProgramFromString("class A:\n  def f(self):\n    return self\n"s),
+                  ParseError);
+}
+
+void TestReturnOutsideMethod() {
+    ASSERT_THROWS(ParseProgramFromString("x = 1\nprint x\nreturn x\nprint 2\n"s), ParseError);
+    ASSERT_THROWS(ParseProgramFromString("if True:\n  return 1\n"s), ParseError);
+    // return в теле метода класса, объявленного внутри метода, допустим
+    ASSERT_DOESNT_THROW(ParseProgramFromString(R"(
+class A:
+  def f():
+    class B:
+      def g():
+        return 1
+    return B()
+)"s));
+}
+
+void TestProgramOwnsArena() {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    {
+        auto tree = ParseProgramFromString(R"(
+class Greeter:
+  def greet(name):
+    return 'Hello, ' + name
+
+g = Greeter()
+)"s);
+        const auto* program = dynamic_cast<const ast::Program*>(tree.get());
+        ASSERT(program != nullptr);
+        ASSERT(program->GetArena().GetAllocatedBytes() > 0);
+        tree->Execute(closure, context);
+    }
+
+    // Класс удерживает арену с телами своих методов после разрушения программы
+    auto* greeter = closure.at("g"s).TryAs<runtime::ClassInstance>();
+    auto result = greeter->Call("greet"s, {runtime::ObjectHolder::Own(runtime::String("arena"s))},
+                                context);
+    ASSERT_EQUAL(result.TryAs<runtime::String>()->GetValue(), "Hello, arena"s);
+}
+
+// Возвращает класс name, определённый программой в closure
+const runtime::Class& GetClass(const runtime::Closure& closure, const string& name) {
+    return *closure.at(name).TryAs<runtime::Class>();
+}
+
+void TestLazyMethods() {
+    const string program = R"(
+class Counter:
+  def __init__(start):
+    self.value = start
+
+  def add(n):
+    total = self.value + n
+    # Комментарий и пустые строки внутри тела
+
+    if total > 10:
+      total = 10
+    self.value = total
+    return self
+
+  def six():
+    return 2 * 3
+
+  def unused():
+    return self.value.missing
+
+class Holder:
+  def make():
+    return Counter(1)
+
+h = Holder()
+c = h.make()
+c.add(4)
+print c.value
+)"s;
+    runtime::DummyContext eager_context;
+    runtime::Closure eager_closure;
+    ParseProgramFromString(program)->Execute(eager_closure, eager_context);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program, true);
+    ast::Optimizer::Optimize(tree);
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), eager_context.output.str());
+    ASSERT_EQUAL(context.output.str(), "5\n"s);
+
+    // Тела вызванных методов разобраны, остальные по-прежнему отложены
+    const runtime::Class& counter = GetClass(closure, "Counter"s);
+    const runtime::Method* add = counter.GetMethod("add"s);
+    ASSERT(add->deferred_body == nullptr && add->body != nullptr);
+    ASSERT(counter.GetMethod("unused"s)->deferred_body != nullptr);
+    ASSERT(counter.GetMethod("six"s)->deferred_body != nullptr);
+
+    // Отложенное тело оптимизируется после разбора
+    auto* instance = closure.at("c"s).TryAs<runtime::ClassInstance>();
+    ASSERT_EQUAL(instance->Call("six"s, {}, context).TryAs<runtime::Number>()->GetValue(), 6);
+    const auto& body = dynamic_cast<const ast::MethodBody&>(*counter.GetMethod("six"s)->body);
+    const auto& statements = dynamic_cast<const ast::Compound&>(body.GetBody()).GetStatements();
+    const auto& ret = dynamic_cast<const ast::Return&>(*statements.at(0));
+    ASSERT(dynamic_cast<const ast::NumericConst*>(&ret.GetStatement()) != nullptr);
+}
+
+void TestLazyMethodErrors() {
+    // Ошибка в теле метода обнаруживается при его вызове, а не при загрузке
+    const string program = R"(
+class A:
+  def ok():
+    return 1
+
+  def broken():
+    return missing(1)
+
+  def forward():
+    return B()
+
+class B:
+  def f():
+    return 2
+
+a = A()
+print a.ok()
+)"s;
+    ASSERT_THROWS(ParseProgramFromString(program), ParseError);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    auto tree = ParseProgramFromString(program, true);
+    tree->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "1\n"s);
+
+    // Метод, тело которого не разобралось, сообщает об ошибке при каждом вызове.
+    // Классы, объявленные после метода, ему не видны, как и при разборе во время загрузки
+    auto* a = closure.at("a"s).TryAs<runtime::ClassInstance>();
+    ASSERT_THROWS(a->Call("broken"s, {}, context), ParseError);
+    ASSERT_THROWS(a->Call("broken"s, {}, context), ParseError);
+    ASSERT_THROWS(a->Call("forward"s, {}, context), ParseError);
+}
+
+void TestLazyMethodsDeclaringClasses() {
+    // Тело, объявляющее класс, разбирается при загрузке: класс виден следующему коду
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    ParseProgramFromString(R"(
+class A:
+  def f():
+    class B:
+      def g():
+        return 'g'
+    return 2
+
+b = B()
+print b.g()
+)"s, true)->Execute(closure, context);
+    ASSERT_EQUAL(context.output.str(), "g\n"s);
+    ASSERT(GetClass(closure, "A"s).GetMethod("f"s)->deferred_body == nullptr);
+}
+
 }  // namespace parse
 
 void TestParseProgram(TestRunner& tr) {
@@ -278,4 +480,11 @@ void TestParseProgram(TestRunner& tr) {
     RUN_TEST(tr, parse::TestComplexLogicalExpression);
     RUN_TEST(tr, parse::TestClassicalPolymorphism);
     RUN_TEST(tr, parse::TestSelfInConstructor);
+    RUN_TEST(tr, parse::TestMethodLocalVariables);
+    RUN_TEST(tr, parse::TestDuplicateParameters);
+    RUN_TEST(tr, parse::TestReturnOutsideMethod);
+    RUN_TEST(tr, parse::TestProgramOwnsArena);
+    RUN_TEST(tr, parse::TestLazyMethods);
+    RUN_TEST(tr, parse::TestLazyMethodErrors);
+    RUN_TEST(tr, parse::TestLazyMethodsDeclaringClasses);
 }
@@ -0,0 +1,142 @@
+#include "pool.h"
+
+#include "runtime.h"
+
+#include <array>
+#include <new>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+
+// Свободный блок пула хранит указатель на следующий свободный блок своего класса
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+constexpr size_t SIZE_CLASS_COUNT = ObjectPool::MAX_SIZE / ObjectPool::GRANULARITY;
+
+size_t GetSizeClass(size_t size) {
+    return (size + ObjectPool::GRANULARITY - 1) / ObjectPool::GRANULARITY - 1;
+}
+
+// Списки свободных блоков потока. При завершении потока блоки возвращаются системе
+struct ObjectPoolState {
+    ObjectPoolState();
+    ObjectPoolState(const ObjectPoolState&) = delete;
+    ObjectPoolState& operator=(const ObjectPoolState&) = delete;
+    ~ObjectPoolState();
+
+    array<FreeBlock*, SIZE_CLASS_COUNT> free_lists{};
+    array<size_t, SIZE_CLASS_COUNT> free_counts{};
+    PoolStats stats;
+};
+
+// Сбрасывается при разрушении пула потока: объекты, освобождаемые позже,
+// возвращаются системе напрямую
+thread_local bool object_pool_alive = false;
+
+ObjectPoolState::ObjectPoolState() {
+    object_pool_alive = true;
+}
+
+ObjectPoolState::~ObjectPoolState() {
+    object_pool_alive = false;
+    for (FreeBlock* block : free_lists) {
+        while (block != nullptr) {
+            FreeBlock* next = block->next;
+            ::operator delete(block);
+            block = next;
+        }
+    }
+}
+
+ObjectPoolState* GetObjectPoolState() {
+    thread_local ObjectPoolState state;
+    return &state;
+}
+
+struct FramePoolState {
+    array<vector<Frame>, FramePool::MAX_FRAME_SIZE + 1> free_frames;
+    PoolStats stats;
+};
+
+FramePoolState& GetFramePoolState() {
+    thread_local FramePoolState state;
+    return state;
+}
+
+}  // namespace
+
+void* ObjectPool::Allocate(size_t size) {
+    if (size == 0 || size > MAX_SIZE) {
+        return ::operator new(size);
+    }
+
+    ObjectPoolState* state = GetObjectPoolState();
+    const size_t size_class = GetSizeClass(size);
+    if (FreeBlock* block = state->free_lists[size_class]) {
+        state->free_lists[size_class] = block->next;
+        --state->free_counts[size_class];
+        ++state->stats.hits;
+        return block;
+    }
+    ++state->stats.misses;
+    return ::operator new((size_class + 1) * GRANULARITY);
+}
+
+void ObjectPool::Deallocate(void* ptr, size_t size) noexcept {
+    if (size == 0 || size > MAX_SIZE || !object_pool_alive) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    ObjectPoolState* state = GetObjectPoolState();
+    const size_t size_class = GetSizeClass(size);
+    if (state->free_counts[size_class] >= MAX_CACHED_BLOCKS) {
+        ::operator delete(ptr);
+        return;
+    }
+    state->free_lists[size_class] = new (ptr) FreeBlock{state->free_lists[size_class]};
+    ++state->free_counts[size_class];
+}
+
+PoolStats ObjectPool::GetStats() {
+    return GetObjectPoolState()->stats;
+}
+
+Frame FramePool::Acquire(size_t size) {
+    FramePoolState& state = GetFramePoolState();
+    if (size <= MAX_FRAME_SIZE && !state.free_frames[size].empty()) {
+        Frame frame = std::move(state.free_frames[size].back());
+        state.free_frames[size].pop_back();
+        ++state.stats.hits;
+        return frame;
+    }
+    ++state.stats.misses;
+    return Frame(size);
+}
+
+void FramePool::Release(Frame&& frame) noexcept {
+    const size_t size = frame.size();
+    FramePoolState& state = GetFramePoolState();
+    if (size == 0 || size > MAX_FRAME_SIZE || state.free_frames[size].size() >= MAX_CACHED_FRAMES) {
+        return;
+    }
+    for (optional<ObjectHolder>& slot : frame) {
+        slot.reset();
+    }
+    try {
+        state.free_frames[size].push_back(std::move(frame));
+    } catch (...) {
+        // Кадр, не поместившийся в пул, просто освобождается
+    }
+}
+
+PoolStats FramePool::GetStats() {
+    return GetFramePoolState().stats;
+}
+
+}  // namespace runtime
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace runtime {
+
+class ObjectHolder;
+
+// Кадр вызова метода. Слот 0 занимает self, затем следуют параметры и локальные переменные.
+// Пустой optional означает, что переменной ещё не было присвоено значение
+using Frame = std::vector<std::optional<ObjectHolder>>;
+
+// Статистика пула: сколько запросов обслужено повторно использованной памятью,
+// а сколько потребовало нового выделения
+struct PoolStats {
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+/*
+ * Пул памяти для объектов Mython. Блоки группируются по классам размеров с шагом GRANULARITY,
+ * освобождённые блоки хранятся в списках свободных блоков и выдаются повторно.
+ * У каждого потока собственные списки, поэтому выделение не требует синхронизации.
+ * Блоки крупнее MAX_SIZE выделяются и освобождаются напрямую
+ */
+class ObjectPool {
+public:
+    static constexpr size_t GRANULARITY = 16;
+    static constexpr size_t MAX_SIZE = 256;
+    // Наибольшее количество свободных блоков одного класса, хранимых потоком
+    static constexpr size_t MAX_CACHED_BLOCKS = 4096;
+
+    static void* Allocate(size_t size);
+    // size должен совпадать с размером, переданным Allocate
+    static void Deallocate(void* ptr, size_t size) noexcept;
+
+    // Возвращает статистику пула текущего потока
+    [[nodiscard]] static PoolStats GetStats();
+};
+
+/*
+ * Пул кадров вызова методов. Освобождённые кадры очищаются, но сохраняют выделенную память
+ * и выдаются повторно вызовам методов с тем же размером кадра. Пул у каждого потока свой
+ */
+class FramePool {
+public:
+    // Кадры большего размера не сохраняются для повторного использования
+    static constexpr size_t MAX_FRAME_SIZE = 32;
+    // Наибольшее количество свободных кадров одного размера, хранимых потоком
+    static constexpr size_t MAX_CACHED_FRAMES = 256;
+
+    // Возвращает кадр из size пустых слотов
+    [[nodiscard]] static Frame Acquire(size_t size);
+    // Возвращает кадр в пул
+    static void Release(Frame&& frame) noexcept;
+
+    // Возвращает статистику пула текущего потока
+    [[nodiscard]] static PoolStats GetStats();
+};
+
+}  // namespace runtime
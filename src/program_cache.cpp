@@ -0,0 +1,658 @@
+#include "program_cache.h"
+
+#include "arena.h"
+#include "source.h"
+#include "statement.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+namespace cache {
+
+using runtime::Executable;
+using runtime::ObjectHolder;
+using runtime::Symbol;
+
+namespace {
+
+// Сигнатура образа и версия формата. Версия увеличивается при любом изменении формата
+constexpr char MAGIC[4] = {'M', 'Y', 'C', '\0'};
+constexpr uint32_t FORMAT_VERSION = 2;
+// Записывается в порядке байтов машины, чтобы отвергать образы с другим порядком
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+// Номер класса, обозначающий отсутствие базового класса
+constexpr uint32_t NO_CLASS = ~uint32_t{0};
+
+// Вид узла AST в образе
+enum class Tag : uint8_t {
+    NumericConst,
+    StringConst,
+    BoolConst,
+    None,
+    Variable,
+    Assignment,
+    FieldAssignment,
+    Print,
+    MethodCall,
+    NewInstance,
+    Stringify,
+    Not,
+    Add,
+    Sub,
+    Mult,
+    Div,
+    Or,
+    And,
+    Comparison,
+    Compound,
+    MethodBody,
+    Return,
+    ClassDefinition,
+    IfElse,
+};
+
+// Записывает образ: узлы и определения классов накапливаются в nodes_,
+// а таблица имён, на которую они ссылаются, добавляется перед ними в Finish
+class Writer {
+public:
+    void WriteNode(const Executable& node);
+
+    [[nodiscard]] string Finish(string_view source) const {
+        string image;
+        Append(image, MAGIC);
+        Append(image, FORMAT_VERSION);
+        Append(image, BYTE_ORDER_MARK);
+        Append(image, static_cast<uint64_t>(source.size()));
+        image.append(source);
+        Append(image, static_cast<uint32_t>(names_.size()));
+        for (Symbol name : names_) {
+            AppendString(image, name.GetName());
+        }
+        return image + nodes_;
+    }
+
+private:
+    template <typename T>
+    static void Append(string& out, const T& value) {
+        static_assert(is_trivially_copyable_v<T>);
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static void AppendString(string& out, string_view text) {
+        Append(out, static_cast<uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    template <typename T>
+    void Write(const T& value) {
+        Append(nodes_, value);
+    }
+
+    void WriteTag(Tag tag) {
+        Write(tag);
+    }
+
+    void WriteCount(size_t count) {
+        Write(static_cast<uint32_t>(count));
+    }
+
+    void WriteName(Symbol name) {
+        auto [it, inserted] = name_indices_.emplace(name, static_cast<uint32_t>(names_.size()));
+        if (inserted) {
+            names_.push_back(name);
+        }
+        Write(it->second);
+    }
+
+    void WriteVariable(const ast::VariableValue& var) {
+        WriteCount(var.GetIds().size());
+        for (Symbol id : var.GetIds()) {
+            WriteName(id);
+        }
+        WriteSlot(var.GetSlot());
+    }
+
+    void WriteSlot(const optional<size_t>& slot) {
+        Write(static_cast<uint8_t>(slot.has_value()));
+        if (slot) {
+            WriteCount(*slot);
+        }
+    }
+
+    void WriteNodes(const vector<unique_ptr<ast::Statement>>& nodes) {
+        WriteCount(nodes.size());
+        for (const auto& node : nodes) {
+            WriteNode(*node);
+        }
+    }
+
+    // Записывает определение класса. Классу назначается номер после его методов, как и при
+    // разборе, поэтому методы могут создавать экземпляры только ранее определённых классов
+    void WriteClass(const runtime::Class& cls) {
+        AppendString(nodes_, cls.GetName());
+        Write(cls.GetParent() != nullptr ? GetClassIndex(*cls.GetParent()) : NO_CLASS);
+
+        // Методы упорядочиваются по имени, чтобы образ не зависел от порядка хеш-таблицы
+        vector<const runtime::Method*> methods;
+        cls.ForEachMethod([&methods](const runtime::Method& method) {
+            methods.push_back(&method);
+        });
+        sort(methods.begin(), methods.end(), [](const auto* lhs, const auto* rhs) {
+            return lhs->name.GetName() < rhs->name.GetName();
+        });
+
+        WriteCount(methods.size());
+        for (const runtime::Method* method : methods) {
+            // Образ хранит построенные тела, поэтому отложенный разбор выполняется сейчас
+            method->Prepare();
+            WriteName(method->name);
+            WriteCount(method->formal_params.size());
+            for (Symbol param : method->formal_params) {
+                WriteName(param);
+            }
+            WriteCount(method->frame_size);
+            WriteNode(*method->body);
+        }
+
+        class_indices_.emplace(&cls, static_cast<uint32_t>(class_indices_.size()));
+    }
+
+    uint32_t GetClassIndex(const runtime::Class& cls) const {
+        auto it = class_indices_.find(&cls);
+        if (it == class_indices_.end()) {
+            throw CacheError("Class "s + cls.GetName() + " is used before its definition"s);
+        }
+        return it->second;
+    }
+
+    string nodes_;
+    vector<Symbol> names_;
+    unordered_map<Symbol, uint32_t> name_indices_;
+    unordered_map<const runtime::Class*, uint32_t> class_indices_;
+};
+
+void Writer::WriteNode(const Executable& node) {
+    if (const auto* num = dynamic_cast<const ast::NumericConst*>(&node)) {
+        WriteTag(Tag::NumericConst);
+        Write(static_cast<int32_t>(num->GetValue().GetValue()));
+    }
+    else if (const auto* str = dynamic_cast<const ast::StringConst*>(&node)) {
+        WriteTag(Tag::StringConst);
+        AppendString(nodes_, str->GetValue().GetValue());
+    }
+    else if (const auto* bool_const = dynamic_cast<const ast::BoolConst*>(&node)) {
+        WriteTag(Tag::BoolConst);
+        Write(static_cast<uint8_t>(bool_const->GetValue().GetValue()));
+    }
+    else if (dynamic_cast<const ast::None*>(&node)) {
+        WriteTag(Tag::None);
+    }
+    else if (const auto* var = dynamic_cast<const ast::VariableValue*>(&node)) {
+        WriteTag(Tag::Variable);
+        WriteVariable(*var);
+    }
+    else if (const auto* assign = dynamic_cast<const ast::Assignment*>(&node)) {
+        WriteTag(Tag::Assignment);
+        WriteName(assign->GetVarName());
+        WriteSlot(assign->GetSlot());
+        WriteNode(assign->GetRvalue());
+    }
+    else if (const auto* field_assign = dynamic_cast<const ast::FieldAssignment*>(&node)) {
+        WriteTag(Tag::FieldAssignment);
+        WriteVariable(field_assign->GetObject());
+        WriteName(field_assign->GetFieldName());
+        WriteNode(field_assign->GetRvalue());
+    }
+    else if (const auto* print = dynamic_cast<const ast::Print*>(&node)) {
+        WriteTag(Tag::Print);
+        WriteNodes(print->GetArgs());
+    }
+    else if (const auto* call = dynamic_cast<const ast::MethodCall*>(&node)) {
+        WriteTag(Tag::MethodCall);
+        WriteNode(call->GetObject());
+        WriteName(call->GetMethodName());
+        WriteNodes(call->GetArgs());
+    }
+    else if (const auto* new_inst = dynamic_cast<const ast::NewInstance*>(&node)) {
+        WriteTag(Tag::NewInstance);
+        Write(GetClassIndex(new_inst->GetClass()));
+        WriteNodes(new_inst->GetArgs());
+    }
+    else if (const auto* stringify = dynamic_cast<const ast::Stringify*>(&node)) {
+        WriteTag(Tag::Stringify);
+        WriteNode(stringify->GetArgument());
+    }
+    else if (const auto* not_op = dynamic_cast<const ast::Not*>(&node)) {
+        WriteTag(Tag::Not);
+        WriteNode(not_op->GetArgument());
+    }
+    else if (const auto* binary = dynamic_cast<const ast::BinaryOperation*>(&node)) {
+        if (const auto* comparison = dynamic_cast<const ast::Comparison*>(&node)) {
+            WriteTag(Tag::Comparison);
+            Write(comparison->GetComparator());
+        }
+        else if (dynamic_cast<const ast::Add*>(&node)) {
+            WriteTag(Tag::Add);
+        }
+        else if (dynamic_cast<const ast::Sub*>(&node)) {
+            WriteTag(Tag::Sub);
+        }
+        else if (dynamic_cast<const ast::Mult*>(&node)) {
+            WriteTag(Tag::Mult);
+        }
+        else if (dynamic_cast<const ast::Div*>(&node)) {
+            WriteTag(Tag::Div);
+        }
+        else if (dynamic_cast<const ast::Or*>(&node)) {
+            WriteTag(Tag::Or);
+        }
+        else if (dynamic_cast<const ast::And*>(&node)) {
+            WriteTag(Tag::And);
+        }
+        else {
+            throw CacheError("Unsupported binary operation in program image"s);
+        }
+        WriteNode(binary->GetLhs());
+        WriteNode(binary->GetRhs());
+    }
+    else if (const auto* compound = dynamic_cast<const ast::Compound*>(&node)) {
+        WriteTag(Tag::Compound);
+        WriteNodes(compound->GetStatements());
+    }
+    else if (const auto* body = dynamic_cast<const ast::MethodBody*>(&node)) {
+        WriteTag(Tag::MethodBody);
+        WriteNode(body->GetBody());
+    }
+    else if (const auto* ret = dynamic_cast<const ast::Return*>(&node)) {
+        WriteTag(Tag::Return);
+        WriteNode(ret->GetStatement());
+    }
+    else if (const auto* class_def = dynamic_cast<const ast::ClassDefinition*>(&node)) {
+        const auto* cls = class_def->GetClass().TryAs<runtime::Class>();
+        if (cls == nullptr || class_indices_.count(cls) != 0) {
+            throw CacheError("Unsupported class definition in program image"s);
+        }
+        WriteTag(Tag::ClassDefinition);
+        WriteClass(*cls);
+    }
+    else if (const auto* if_else = dynamic_cast<const ast::IfElse*>(&node)) {
+        WriteTag(Tag::IfElse);
+        WriteNode(if_else->GetCondition());
+        WriteNode(if_else->GetIfBody());
+        Write(static_cast<uint8_t>(if_else->GetElseBody() != nullptr));
+        if (if_else->GetElseBody() != nullptr) {
+            WriteNode(*if_else->GetElseBody());
+        }
+    }
+    else {
+        throw CacheError("Unsupported node in program image"s);
+    }
+}
+
+// Читает образ, проверяя каждое обращение к нему: повреждённый образ
+// приводит к исключению CacheError, а не к чтению за его пределами
+class Reader {
+public:
+    // storage - владелец памяти, в которой размещаются узлы, например арена программы
+    Reader(string_view data, shared_ptr<const void> storage)
+        : data_(data)
+        , storage_(std::move(storage))
+    { /* do nothing */ }
+
+    void ReadHeader(string_view source) {
+        if (Take(sizeof(MAGIC)) != string_view(MAGIC, sizeof(MAGIC))
+            || Read<uint32_t>() != FORMAT_VERSION || Read<uint32_t>() != BYTE_ORDER_MARK) {
+            throw CacheError("Unsupported program image format"s);
+        }
+        // Хеш в имени файла образа может совпасть у разных текстов,
+        // поэтому образ принимается, только если сохранённый в нём текст совпадает с source
+        if (Read<uint64_t>() != source.size() || Take(source.size()) != source) {
+            throw CacheError("Program image was built for a different source"s);
+        }
+
+        const size_t count = ReadCount();
+        names_.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            names_.emplace_back(ReadString());
+        }
+    }
+
+    // Читает корневой узел. Узлы размещаются в текущей арене
+    unique_ptr<ast::Statement> ReadRoot() {
+        auto root = ReadNode();
+        if (pos_ != data_.size()) {
+            throw CacheError("Unexpected data after the end of program image"s);
+        }
+        return root;
+    }
+
+private:
+    string_view Take(size_t size) {
+        if (data_.size() - pos_ < size) {
+            throw CacheError("Program image is truncated"s);
+        }
+        string_view result = data_.substr(pos_, size);
+        pos_ += size;
+        return result;
+    }
+
+    template <typename T>
+    T Read() {
+        static_assert(is_trivially_copyable_v<T>);
+        T value;
+        memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    size_t ReadCount() {
+        const auto count = Read<uint32_t>();
+        // Каждый элемент занимает в образе хотя бы один байт
+        if (count > data_.size() - pos_) {
+            throw CacheError("Program image is truncated"s);
+        }
+        return count;
+    }
+
+    string_view ReadString() {
+        return Take(Read<uint32_t>());
+    }
+
+    Symbol ReadName() {
+        const auto index = Read<uint32_t>();
+        if (index >= names_.size()) {
+            throw CacheError("Invalid name in program image"s);
+        }
+        return names_[index];
+    }
+
+    optional<size_t> ReadSlot() {
+        if (Read<uint8_t>() == 0) {
+            return nullopt;
+        }
+        const size_t slot = Read<uint32_t>();
+        // Слоты назначаются только переменным метода и не выходят за пределы его кадра
+        if (slot >= frame_size_) {
+            throw CacheError("Invalid frame slot in program image"s);
+        }
+        return slot;
+    }
+
+    // Символы читаются в заранее выделенный вектор: конструктор Symbol по умолчанию
+    // обращается к таблице символов
+    vector<Symbol> ReadNames() {
+        const size_t count = ReadCount();
+        vector<Symbol> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            names.push_back(ReadName());
+        }
+        return names;
+    }
+
+    vector<Symbol> ReadIds() {
+        vector<Symbol> ids = ReadNames();
+        if (ids.empty()) {
+            throw CacheError("Empty variable in program image"s);
+        }
+        return ids;
+    }
+
+    ast::VariableValue ReadVariable() {
+        vector<Symbol> ids = ReadIds();
+        if (optional<size_t> slot = ReadSlot()) {
+            return ast::VariableValue(std::move(ids), *slot);
+        }
+        return ast::VariableValue(std::move(ids));
+    }
+
+    vector<unique_ptr<ast::Statement>> ReadNodes() {
+        vector<unique_ptr<ast::Statement>> nodes(ReadCount());
+        for (auto& node : nodes) {
+            node = ReadNode();
+        }
+        return nodes;
+    }
+
+    const runtime::Class& GetClass(uint32_t index) const {
+        if (index >= classes_.size()) {
+            throw CacheError("Invalid class in program image"s);
+        }
+        return *classes_[index].TryAs<runtime::Class>();
+    }
+
+    ObjectHolder ReadClass() {
+        string name(ReadString());
+        const auto parent_index = Read<uint32_t>();
+        const runtime::Class* parent = parent_index != NO_CLASS ? &GetClass(parent_index) : nullptr;
+
+        const size_t method_count = ReadCount();
+        vector<runtime::Method> methods;
+        methods.reserve(method_count);
+        for (size_t i = 0; i < method_count; ++i) {
+            Symbol method_name = ReadName();
+            vector<Symbol> params = ReadNames();
+            const size_t frame_size = Read<uint32_t>();
+            if (frame_size != 0 && frame_size <= params.size()) {
+                throw CacheError("Invalid frame size in program image"s);
+            }
+
+            const size_t outer_frame_size = exchange(frame_size_, frame_size);
+            const bool outer_in_method = exchange(in_method_, true);
+            auto body = ReadNode();
+            frame_size_ = outer_frame_size;
+            in_method_ = outer_in_method;
+            methods.push_back({method_name, std::move(params), std::move(body), frame_size});
+        }
+
+        classes_.push_back(
+            ObjectHolder::Own(runtime::Class(std::move(name), std::move(methods), parent, storage_)));
+        return classes_.back();
+    }
+
+    template <typename Operation>
+    unique_ptr<ast::Statement> ReadBinary() {
+        auto lhs = ReadNode();
+        auto rhs = ReadNode();
+        return make_unique<Operation>(std::move(lhs), std::move(rhs));
+    }
+
+    unique_ptr<ast::Statement> ReadNode();
+
+    string_view data_;
+    size_t pos_ = 0;
+    shared_ptr<const void> storage_; // Владелец памяти тел методов
+    vector<Symbol> names_;
+    vector<ObjectHolder> classes_; // Классы в порядке определения
+    size_t frame_size_ = 0;        // Размер кадра метода, тело которого читается
+    bool in_method_ = false;       // Читается ли тело метода
+};
+
+unique_ptr<ast::Statement> Reader::ReadNode() {
+    switch (Read<Tag>()) {
+        case Tag::NumericConst:
+            return make_unique<ast::NumericConst>(Read<int32_t>());
+        case Tag::StringConst:
+            return make_unique<ast::StringConst>(string(ReadString()));
+        case Tag::BoolConst:
+            return make_unique<ast::BoolConst>(Read<uint8_t>() != 0);
+        case Tag::None:
+            return make_unique<ast::None>();
+        case Tag::Variable:
+            return make_unique<ast::VariableValue>(ReadVariable());
+        case Tag::Assignment: {
+            Symbol var = ReadName();
+            optional<size_t> slot = ReadSlot();
+            auto rv = ReadNode();
+            if (slot) {
+                return make_unique<ast::Assignment>(var, std::move(rv), *slot);
+            }
+            return make_unique<ast::Assignment>(var, std::move(rv));
+        }
+        case Tag::FieldAssignment: {
+            ast::VariableValue object = ReadVariable();
+            Symbol field = ReadName();
+            auto rv = ReadNode();
+            return make_unique<ast::FieldAssignment>(std::move(object), field, std::move(rv));
+        }
+        case Tag::Print:
+            return make_unique<ast::Print>(ReadNodes());
+        case Tag::MethodCall: {
+            auto object = ReadNode();
+            Symbol method = ReadName();
+            return make_unique<ast::MethodCall>(std::move(object), method, ReadNodes());
+        }
+        case Tag::NewInstance: {
+            const runtime::Class& cls = GetClass(Read<uint32_t>());
+            return make_unique<ast::NewInstance>(cls, ReadNodes());
+        }
+        case Tag::Stringify:
+            return make_unique<ast::Stringify>(ReadNode());
+        case Tag::Not:
+            return make_unique<ast::Not>(ReadNode());
+        case Tag::Add:
+            return ReadBinary<ast::Add>();
+        case Tag::Sub:
+            return ReadBinary<ast::Sub>();
+        case Tag::Mult:
+            return ReadBinary<ast::Mult>();
+        case Tag::Div:
+            return ReadBinary<ast::Div>();
+        case Tag::Or:
+            return ReadBinary<ast::Or>();
+        case Tag::And:
+            return ReadBinary<ast::And>();
+        case Tag::Comparison: {
+            const auto cmp = Read<runtime::Comparator>();
+            if (cmp > runtime::Comparator::GreaterOrEqual) {
+                throw CacheError("Invalid comparison in program image"s);
+            }
+            auto lhs = ReadNode();
+            auto rhs = ReadNode();
+            return make_unique<ast::Comparison>(cmp, std::move(lhs), std::move(rhs));
+        }
+        case Tag::Compound: {
+            auto compound = make_unique<ast::Compound>();
+            for (auto& statement : ReadNodes()) {
+                compound->AddStatement(std::move(statement));
+            }
+            return compound;
+        }
+        case Tag::MethodBody:
+            return make_unique<ast::MethodBody>(ReadNode());
+        case Tag::Return:
+            if (!in_method_) {
+                throw CacheError("Return outside of method in program image"s);
+            }
+            return make_unique<ast::Return>(ReadNode());
+        case Tag::ClassDefinition:
+            return make_unique<ast::ClassDefinition>(ReadClass());
+        case Tag::IfElse: {
+            auto condition = ReadNode();
+            auto if_body = ReadNode();
+            unique_ptr<ast::Statement> else_body;
+            if (Read<uint8_t>() != 0) {
+                else_body = ReadNode();
+            }
+            return make_unique<ast::IfElse>(std::move(condition), std::move(if_body),
+                                            std::move(else_body));
+        }
+    }
+    throw CacheError("Invalid node in program image"s);
+}
+
+}  // namespace
+
+string SerializeProgram(const Executable& program, string_view source) {
+    const auto* root = dynamic_cast<const ast::Program*>(&program);
+    Writer writer;
+    writer.WriteNode(root != nullptr ? root->GetRoot() : program);
+    return writer.Finish(source);
+}
+
+unique_ptr<Executable> DeserializeProgram(string_view data, string_view source) {
+    auto arena = make_shared<runtime::Arena>();
+    Reader reader(data, arena);
+    reader.ReadHeader(source);
+
+    unique_ptr<ast::Statement> root;
+    {
+        runtime::ArenaScope arena_scope(arena.get());
+        root = reader.ReadRoot();
+    }
+    return make_unique<ast::Program>(std::move(arena), std::move(root));
+}
+
+ProgramCache::ProgramCache(string directory)
+    : directory_(std::move(directory))
+{ /* do nothing */ }
+
+unique_ptr<Executable> ProgramCache::Load(string_view source) const {
+    const string path = GetPath(source);
+    error_code error;
+    if (!filesystem::is_regular_file(path, error)) {
+        return nullptr;
+    }
+    try {
+        // Образ читается прямо из отображённого в память файла
+        const parse::Source image = parse::Source::MapFile(path);
+        return DeserializeProgram(image.GetText(), source);
+    } catch (const runtime_error&) {
+        return nullptr;
+    }
+}
+
+bool ProgramCache::Store(string_view source, const Executable& program) const {
+    string image;
+    try {
+        image = SerializeProgram(program, source);
+    } catch (const exception&) {
+        // Ошибка разбора отложенного тела метода будет сообщена при его вызове
+        return false;
+    }
+
+    // Образ записывается во временный файл и переименовывается, чтобы параллельно
+    // запущенные интерпретаторы не прочитали недописанный образ
+    const string path = GetPath(source);
+    const string temp_path = path + '.' + to_string(random_device{}()) + ".tmp"s;
+    error_code error;
+    filesystem::create_directories(directory_, error);
+    {
+        ofstream out(temp_path, ios::binary | ios::trunc);
+        if (!out.write(image.data(), static_cast<streamsize>(image.size())) || !out.flush()) {
+            out.close();
+            filesystem::remove(temp_path, error);
+            return false;
+        }
+    }
+    filesystem::rename(temp_path, path, error);
+    if (error) {
+        filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+string ProgramCache::GetPath(string_view source) const {
+    // 64-битный хеш FNV-1a текста программы
+    uint64_t hash = 14695981039346656037ULL;
+    for (char ch : source) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ULL;
+    }
+
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    string name(16, '0');
+    for (size_t i = 0; i < name.size(); ++i) {
+        name[name.size() - 1 - i] = DIGITS[(hash >> (4 * i)) & 0xF];
+    }
+    return (filesystem::path(directory_) / (name + ".myc"s)).string();
+}
+
+}  // namespace cache
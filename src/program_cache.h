@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace runtime {
+class Executable;
+}
+
+namespace cache {
+
+// Ошибка чтения либо записи образа программы
+struct CacheError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/*
+ * Двоичный образ программы, построенной ParseProgram: исходный текст программы, таблица имён,
+ * определения классов с телами методов и узлы AST в прямом порядке обхода. Образ
+ * предназначен для той же сборки интерпретатора на той же машине, поэтому числа
+ * записываются в её порядке байтов. Сохраняется программа до оптимизации: оптимизатор
+ * применяется после загрузки
+ */
+
+// Возвращает образ программы program, разобранной из текста source.
+// Тела методов, разбор которых был отложен, разбираются и сохраняются в образе.
+// Выбрасывает CacheError, если программа содержит узлы, не создаваемые парсером,
+// и ParseError либо LexerError, если отложенное тело содержит ошибку
+[[nodiscard]] std::string SerializeProgram(const runtime::Executable& program,
+                                           std::string_view source);
+
+// Восстанавливает из образа data программу, узлы которой размещены в её собственной арене.
+// Выбрасывает CacheError, если образ повреждён, записан другой версией формата
+// либо построен не для текста source: текст, сохранённый в образе, сравнивается с source
+[[nodiscard]] std::unique_ptr<runtime::Executable> DeserializeProgram(std::string_view data,
+                                                                      std::string_view source);
+
+/*
+ * Каталог образов разобранных программ. Имя файла образа - 64-битный хеш исходного
+ * текста, поэтому повторный запуск того же текста загружает отображённый в память образ
+ * вместо лексического и синтаксического разбора. Образ хранит сам текст, так что
+ * совпадение хешей разных текстов не приводит к исполнению чужой программы
+ */
+class ProgramCache {
+public:
+    explicit ProgramCache(std::string directory);
+
+    // Возвращает программу из образа для текста source либо nullptr, если образа нет
+    // или он непригоден. Непригодный образ перезаписывается следующим вызовом Store
+    [[nodiscard]] std::unique_ptr<runtime::Executable> Load(std::string_view source) const;
+
+    // Сохраняет образ программы program, разобранной из текста source. Возвращает false,
+    // если программу не удалось сохранить: кэш лишь ускоряет запуск, поэтому ошибки записи
+    // не прерывают работу
+    bool Store(std::string_view source, const runtime::Executable& program) const;
+
+    // Возвращает путь к файлу образа для текста source
+    [[nodiscard]] std::string GetPath(std::string_view source) const;
+
+private:
+    std::string directory_;
+};
+
+}  // namespace cache
@@ -0,0 +1,131 @@
+#include "lexer.h"
+#include "parse.h"
+#include "program_cache.h"
+#include "runtime.h"
+#include "test_runner_p.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace std;
+
+namespace cache {
+
+namespace {
+
+const string PROGRAM = R"(
+class Shape:
+  def __init__(name):
+    self.name = name
+
+  def area():
+    return 0
+
+  def __str__():
+    return self.name + ' ' + str(self.area())
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.name = 'rect'
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+class Factory:
+  def make(n):
+    if n > 2 and not n == 4:
+      return Rect(n, n - 1)
+    else:
+      return Shape('dot')
+
+f = Factory()
+r = f.make(5)
+print f.make(3), f.make(4), r.area() / 2 - 1
+print None, True, "it's", 1 <= 2 or False
+)"s;
+
+unique_ptr<runtime::Executable> Parse(const string& text) {
+    parse::Lexer lexer(parse::Source::FromString(text));
+    return ParseProgram(lexer);
+}
+
+string Run(runtime::Executable& program) {
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    program.Execute(closure, context);
+    return context.output.str();
+}
+
+void TestRoundTrip() {
+    auto program = Parse(PROGRAM);
+    const string image = SerializeProgram(*program, PROGRAM);
+
+    auto loaded = DeserializeProgram(image, PROGRAM);
+    // Образ восстановленной программы совпадает с исходным байт в байт
+    ASSERT_EQUAL(SerializeProgram(*loaded, PROGRAM), image);
+    ASSERT_EQUAL(Run(*loaded), Run(*program));
+    ASSERT_EQUAL(Run(*loaded), "rect 6 dot 0 9\nNone True it's True\n"s);
+}
+
+void TestRejectsInvalidImages() {
+    const string image = SerializeProgram(*Parse(PROGRAM), PROGRAM);
+
+    // Образ другого текста
+    ASSERT_THROWS(static_cast<void>(DeserializeProgram(image, "print 1"s)), CacheError);
+    // Образ текста той же длины, отличающегося одним символом
+    string same_size = PROGRAM;
+    same_size[same_size.size() / 2] ^= 1;
+    ASSERT_THROWS(static_cast<void>(DeserializeProgram(image, same_size)), CacheError);
+    // Усечённый образ
+    for (size_t size : {size_t{0}, size_t{3}, image.size() / 2, image.size() - 1}) {
+        ASSERT_THROWS(static_cast<void>(DeserializeProgram(image.substr(0, size), PROGRAM)),
+                      CacheError);
+    }
+    // Лишние данные после конца образа
+    ASSERT_THROWS(static_cast<void>(DeserializeProgram(image + '\0', PROGRAM)), CacheError);
+    // Другая версия формата
+    string other_version = image;
+    ++other_version[4];
+    ASSERT_THROWS(static_cast<void>(DeserializeProgram(other_version, PROGRAM)), CacheError);
+}
+
+void TestCacheDirectory() {
+    const filesystem::path directory = filesystem::temp_directory_path()
+                                       / ("mython_cache_test_"s + to_string(random_device{}()));
+    const ProgramCache cache(directory.string());
+
+    ASSERT(cache.Load(PROGRAM) == nullptr);
+    ASSERT(cache.Store(PROGRAM, *Parse(PROGRAM)));
+    ASSERT(filesystem::is_regular_file(cache.GetPath(PROGRAM)));
+    auto loaded = cache.Load(PROGRAM);
+    ASSERT(loaded != nullptr);
+    ASSERT_EQUAL(Run(*loaded), Run(*Parse(PROGRAM)));
+
+    // Повреждённый образ не загружается, а перезаписывается при следующем сохранении
+    ofstream(cache.GetPath(PROGRAM), ios::binary | ios::trunc) << "garbage"s;
+    ASSERT(cache.Load(PROGRAM) == nullptr);
+    ASSERT(cache.Store(PROGRAM, *Parse(PROGRAM)));
+    ASSERT(cache.Load(PROGRAM) != nullptr);
+
+    // Образ, оказавшийся на месте образа другого текста, например при совпадении хешей,
+    // не загружается для этого текста
+    const string other = "print 1"s;
+    filesystem::copy_file(cache.GetPath(PROGRAM), cache.GetPath(other));
+    ASSERT(cache.Load(other) == nullptr);
+    ASSERT(cache.Load(PROGRAM) != nullptr);
+
+    filesystem::remove_all(directory);
+}
+
+}  // namespace
+
+void RunProgramCacheTests(TestRunner& tr) {
+    RUN_TEST(tr, cache::TestRoundTrip);
+    RUN_TEST(tr, cache::TestRejectsInvalidImages);
+    RUN_TEST(tr, cache::TestCacheDirectory);
+}
+
+}  // namespace cache
@@ -1,6 +1,12 @@
 #include "runtime.h"
 
+#include "arena.h"
+#include "gc.h"
+
+#include <algorithm>
 #include <cassert>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <sstream>
 
@@ -9,22 +15,109 @@ using namespace std;
 namespace runtime {
 
 namespace {
-const string STR_METHOD = "__str__"s;
-const string EQ_METHOD = "__eq__"s;
-const string LT_METHOD = "__lt__"s;
+// Имена специальных методов в порядке перечисления SpecialMethod
+const array<string, static_cast<size_t>(SpecialMethod::Count)> SPECIAL_METHOD_NAMES = {
+    "__str__"s, "__eq__"s, "__lt__"s, "__add__"s, "__init__"s,
+};
+
+const Symbol SELF{"self"sv};
+
+// Идентификаторы имён методов. Имена регистрируются при разборе программ,
+// которые могут разбираться в нескольких потоках, поэтому таблица защищена мьютексом
+class MethodIdTable {
+public:
+    MethodId Intern(Symbol name) {
+        lock_guard guard(mutex_);
+        return ids_.emplace(name, static_cast<MethodId>(ids_.size())).first->second;
+    }
+
+private:
+    mutex mutex_;
+    unordered_map<Symbol, MethodId> ids_;
+};
+
+MethodIdTable& GetMethodIds() {
+    static MethodIdTable method_ids;
+    return method_ids;
+}
 } // namespace
 
-ObjectHolder::ObjectHolder(std::shared_ptr<Object> data)
-    : data_(std::move(data)) {
+MethodId InternMethodName(Symbol name) {
+    return GetMethodIds().Intern(name);
+}
+
+namespace {
+// Заголовок, предшествующий каждому объекту Executable
+struct alignas(std::max_align_t) ExecutableHeader {
+    bool in_arena = false; // Объект размещён в арене
+};
+}  // namespace
+
+void* Executable::operator new(std::size_t size) {
+    const size_t total_size = sizeof(ExecutableHeader) + size;
+    Arena* arena = Arena::GetCurrent();
+    void* memory = arena != nullptr ? arena->Allocate(total_size) : ::operator new(total_size);
+    auto* header = new (memory) ExecutableHeader{arena != nullptr};
+    return header + 1;
+}
+
+void Executable::operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto* header = static_cast<ExecutableHeader*>(ptr) - 1;
+    if (!header->in_arena) {
+        ::operator delete(header);
+    }
+}
+
+namespace {
+// Заголовок, предшествующий каждому объекту Object в куче
+struct alignas(std::max_align_t) ObjectHeader {
+    MemoryAccount* account = nullptr; // Счёт, в котором учтена память объекта
+};
+}  // namespace
+
+void* Object::operator new(std::size_t size) {
+    const size_t total_size = sizeof(ObjectHeader) + size;
+    MemoryAccount* account = MemoryAccount::GetCurrent();
+    if (account != nullptr) {
+        account->Allocate(total_size);
+    }
+    void* memory = nullptr;
+    try {
+        memory = ObjectPool::Allocate(total_size);
+    } catch (...) {
+        if (account != nullptr) {
+            account->Release(total_size);
+        }
+        throw;
+    }
+    auto* header = new (memory) ObjectHeader{account};
+    return header + 1;
+}
+
+void Object::operator delete(void* ptr, std::size_t size) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto* header = static_cast<ObjectHeader*>(ptr) - 1;
+    const size_t total_size = sizeof(ObjectHeader) + size;
+    if (header->account != nullptr) {
+        header->account->Release(total_size);
+    }
+    ObjectPool::Deallocate(header, total_size);
 }
 
 void ObjectHolder::AssertIsValid() const {
-    assert(data_ != nullptr);
+    assert(tag_ != Tag::None);
 }
 
 ObjectHolder ObjectHolder::Share(Object& object) {
-    // Возвращаем невладеющий shared_ptr (его deleter ничего не делает)
-    return ObjectHolder(std::shared_ptr<Object>(&object, [](auto* /*p*/) { /* do nothing */ }));
+    ObjectHolder result;
+    result.object_ = &object;
+    result.tag_ = Tag::Borrowed;
+    return result;
 }
 
 ObjectHolder ObjectHolder::None() {
@@ -41,93 +134,255 @@ Object* ObjectHolder::operator->() const {
     return Get();
 }
 
-Object* ObjectHolder::Get() const {
-    return data_.get();
-}
-
-ObjectHolder::operator bool() const {
-    return Get() != nullptr;
-}
-
 bool IsTrue(const ObjectHolder& object) {
-    if (!object) {
+    switch (object.GetType()) {
+    case ObjectType::Bool:
+        return static_cast<const Bool*>(object.Get())->GetValue();
+    case ObjectType::Number:
+        return static_cast<const Number*>(object.Get())->GetValue() != 0;
+    case ObjectType::String:
+        return static_cast<const String*>(object.Get())->GetSize() != 0;
+    default:
         return false;
     }
-
-    if(object.TryAs<Bool>() != nullptr) {
-        return object.TryAs<Bool>()->GetValue();
-    }
-    if (object.TryAs<Number>() != nullptr) {
-        return object.TryAs<Number>()->GetValue() != 0;
-    }
-    if (object.TryAs<String>() != nullptr) {
-        return !object.TryAs<String>()->GetValue().empty();
-    }
-
-    return false;
 }
 
 void ClassInstance::Print(std::ostream& os, Context& context) {
-    if (HasMethod(STR_METHOD, 0)) {
-        Call(STR_METHOD, {}, context)->Print(os, context);
+    if (const Method* str = GetSpecialMethod(SpecialMethod::Str, 0)) {
+        PrintValue(Call(*str, {}, context), os, context,
+                   [&context](ClassInstance& instance, const Method& method) {
+                       return instance.Call(method, {}, context);
+                   });
     }
     else {
         os << this;
     }
 }
 
-bool ClassInstance::HasMethod(const std::string& method, size_t argument_count) const {
+bool ClassInstance::HasMethod(Symbol method, size_t argument_count) const {
     const Method* mth = cls_.GetMethod(method);
     return mth != nullptr && mth->formal_params.size() == argument_count;
 }
 
+const Class& ClassInstance::GetClass() const {
+    return cls_;
+}
+
 Closure& ClassInstance::Fields() {
-    return closure_;
+    return ToDictionary();
 }
 
 const Closure& ClassInstance::Fields() const {
-    return closure_;
+    return ToDictionary();
 }
 
 ClassInstance::ClassInstance(const Class& cls)
-    : cls_(cls)
-{ /* do nothing */ }
+    : Object(ObjectType::ClassInstance)
+    , cls_(cls)
+    , shape_(cls.GetRootShape()) {
+    if (GarbageCollector* gc = GarbageCollector::GetCurrent()) {
+        gc->Register(*this);
+    }
+}
+
+ClassInstance::ClassInstance(ClassInstance&& other) noexcept
+    : Object(other)
+    , cls_(other.cls_)
+    , shape_(other.shape_)
+    , values_(std::move(other.values_))
+    , fields_(std::move(other.fields_))
+    , fields_charge_(std::move(other.fields_charge_)) {
+    if (GarbageCollector* gc = GarbageCollector::GetCurrent()) {
+        gc->Register(*this);
+    }
+}
+
+ClassInstance::~ClassInstance() {
+    if (gc_ != nullptr) {
+        gc_->Unregister(*this);
+    }
+}
+
+ObjectHolder* ClassInstance::FindField(Symbol name, FieldCache& cache) {
+    if (shape_ == nullptr) {
+        auto it = fields_->find(name);
+        return it != fields_->end() ? &it->second : nullptr;
+    }
+
+    if (cache.shape == shape_ && cache.next_shape == nullptr) {
+        return &values_[cache.offset];
+    }
+
+    const size_t offset = shape_->FindOffset(name);
+    if (offset == Shape::NO_FIELD) {
+        return nullptr;
+    }
+    cache = {shape_, nullptr, offset};
+    return &values_[offset];
+}
+
+ObjectHolder& ClassInstance::SetField(Symbol name, ObjectHolder value,
+                                      FieldCache& cache) {
+    if (shape_ == nullptr) {
+        auto it = fields_->find(name);
+        if (it == fields_->end()) {
+            fields_charge_.Resize(fields_charge_.GetBytes() + sizeof(Closure::value_type));
+            it = fields_->emplace(name, ObjectHolder::None()).first;
+        }
+        return it->second = std::move(value);
+    }
+
+    if (cache.shape != shape_) {
+        const size_t offset = shape_->FindOffset(name);
+        cache = offset != Shape::NO_FIELD
+            ? FieldCache{shape_, nullptr, offset}
+            : FieldCache{shape_, shape_->AddField(name), values_.size()};
+    }
+
+    // Добавление нового поля переводит объект в следующую форму
+    if (cache.next_shape != nullptr) {
+        // Хранилище полей расширяется и учитывается до изменения объекта,
+        // поэтому превышение лимита памяти оставляет объект прежним
+        if (values_.size() == values_.capacity()) {
+            const size_t capacity = std::max<size_t>(4, values_.capacity() * 2);
+            fields_charge_.Resize(capacity * sizeof(ObjectHolder));
+            values_.reserve(capacity);
+        }
+        shape_ = cache.next_shape;
+        values_.push_back(std::move(value));
+        return values_.back();
+    }
+    return values_[cache.offset] = std::move(value);
+}
+
+Closure& ClassInstance::ToDictionary() const {
+    if (shape_ != nullptr) {
+        fields_charge_.Resize(values_.size() * sizeof(Closure::value_type));
+        fields_ = std::make_unique<Closure>();
+        const std::vector<Symbol>& names = shape_->GetFieldNames();
+        for (size_t i = 0; i < values_.size(); ++i) {
+            (*fields_)[names[i]] = std::move(values_[i]);
+        }
+        values_.clear();
+        values_.shrink_to_fit();
+        shape_ = nullptr;
+    }
+    return *fields_;
+}
 
-ObjectHolder ClassInstance::Call(const std::string& method,
+ObjectHolder ClassInstance::Call(Symbol method,
                                  const std::vector<ObjectHolder>& actual_args,
                                  Context& context)
 {
-    if (!HasMethod(method, actual_args.size())) {
+    const Method* method_ptr = cls_.GetMethod(method);
+    if (method_ptr == nullptr || method_ptr->formal_params.size() != actual_args.size()) {
         throw std::runtime_error("Method "s + method + " wasn't found in class "s + cls_.GetName());
     }
 
-    const Method* method_ptr = cls_.GetMethod(method);
+    return Call(*method_ptr, actual_args, context);
+}
+
+void Method::ParseDeferredBody() const {
+    // Методы хранятся в таблице методов класса и не являются константными объектами:
+    // константна лишь ссылка, через которую метод вызывается
+    auto& method = const_cast<Method&>(*this);
+    deferred_body->Parse(method);
+    for (const DeferredBody::Transform& transform : deferred_body->GetTransforms()) {
+        transform(method.body);
+    }
+    method.deferred_body.reset();
+}
+
+ObjectHolder ClassInstance::Call(const Method& method, const std::vector<ObjectHolder>& actual_args,
+                                 Context& context)
+{
+    method.Prepare();
+    // Переменные метода, разрешённые при разборе, хранятся в слотах кадра
+    if (method.frame_size > 0) {
+        PooledFrame frame(method.frame_size);
+        for (size_t i = 0; i < actual_args.size(); ++i) {
+            (*frame)[i + 1] = actual_args[i];
+        }
+        return CallWithFrame(method, *frame, context);
+    }
+
     Closure method_vars;
-    method_vars["self"s] = ObjectHolder::Share(*this);
-    for (size_t i = 0; i < method_ptr->formal_params.size(); ++i) {
-        method_vars[method_ptr->formal_params.at(i)] = actual_args[i];
+    method_vars[SELF] = ObjectHolder::Share(*this);
+    for (size_t i = 0; i < method.formal_params.size(); ++i) {
+        method_vars[method.formal_params.at(i)] = actual_args[i];
     }
 
-    return method_ptr->body->Execute(method_vars, context);
+    FrameScope frame_scope(context, nullptr);
+    return method.body->Execute(method_vars, context);
 }
 
-Class::Class(std::string name, std::vector<Method> methods, const Class* parent)
-    : name_(name)
+ObjectHolder ClassInstance::CallWithFrame(const Method& method, Frame& frame, Context& context) {
+    frame[0] = ObjectHolder::Share(*this);
+    FrameScope frame_scope(context, &frame);
+    Closure unused_closure;
+    return method.body->Execute(unused_closure, context);
+}
+
+Class::Class(std::string name, std::vector<Method> methods, const Class* parent,
+             std::shared_ptr<const void> storage)
+    : Object(ObjectType::Class)
+    , name_(name)
     , parent_(parent)
+    , storage_(std::move(storage))
 {
+    if (parent_ != nullptr) {
+        method_table_ = parent_->method_table_;
+        special_methods_ = parent_->special_methods_;
+    }
+
+    // Собственные методы класса замещают унаследованные
     for (Method& method : methods) {
-        names_to_methods_[method.name] = std::move(method);
+        const MethodId id = InternMethodName(method.name);
+        Method& own = names_to_methods_[method.name] = std::move(method);
+        auto it = lower_bound(method_table_.begin(), method_table_.end(), id,
+                              [](const MethodEntry& entry, MethodId id) {
+                                  return entry.id < id;
+                              });
+        if (it != method_table_.end() && it->id == id) {
+            it->method = &own;
+        }
+        else {
+            method_table_.insert(it, {id, &own});
+        }
     }
-}
 
-const Method* Class::GetMethod(const std::string& name) const {
-    if (names_to_methods_.find(name) != names_to_methods_.end()) {
-        return &names_to_methods_.at(name);
+    for (size_t i = 0; i < SPECIAL_METHOD_NAMES.size(); ++i) {
+        auto it = names_to_methods_.find(SPECIAL_METHOD_NAMES[i]);
+        if (it != names_to_methods_.end()) {
+            special_methods_[i] = &it->second;
+        }
     }
-    else if (parent_ != nullptr) {
-        return parent_->GetMethod(name);
+}
+
+size_t Shape::FindOffset(Symbol name) const {
+    auto it = offsets_.find(name);
+    return it != offsets_.end() ? it->second : NO_FIELD;
+}
+
+const Shape* Shape::AddField(Symbol name) const {
+    std::unique_ptr<Shape>& next = transitions_[name];
+    if (!next) {
+        next = std::make_unique<Shape>();
+        next->names_ = names_;
+        next->names_.push_back(name);
+        next->offsets_ = offsets_;
+        next->offsets_[name] = names_.size();
     }
+    return next.get();
+}
 
+const Method* Class::GetMethod(Symbol name) const {
+    for (const Class* cls = this; cls != nullptr; cls = cls->parent_) {
+        auto it = cls->names_to_methods_.find(name);
+        if (it != cls->names_to_methods_.end()) {
+            return &it->second;
+        }
+    }
     return nullptr;
 }
 
@@ -139,45 +394,190 @@ void Class::Print(ostream& os, Context& /*context*/) {
     os << "Class "sv << name_;
 }
 
-void Bool::Print(std::ostream& os, [[maybe_unused]] Context& context) {
-    os << (GetValue() ? "True"sv : "False"sv);
-}
+// Узел дерева частей строки: лист с непрерывным содержимым либо конкатенация двух узлов.
+// Объединённое содержимое узла конкатенации сохраняется в нём самом, а дочерние узлы
+// освобождаются, поэтому содержимое объединяется не более одного раза
+struct String::Node {
+    explicit Node(std::string content)
+        : size(content.size())
+        , value(std::move(content))
+        , charge(sizeof(Node) + size) {
+    }
 
-bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
-    if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
-        return lhs.TryAs<Bool>()->GetValue() == rhs.TryAs<Bool>()->GetValue();
+    Node(std::shared_ptr<const Node> lhs, std::shared_ptr<const Node> rhs)
+        : size(lhs->size + rhs->size)
+        , left(std::move(lhs))
+        , right(std::move(rhs))
+        , charge(sizeof(Node)) {
     }
-    if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
-        return lhs.TryAs<Number>()->GetValue() == rhs.TryAs<Number>()->GetValue();
+
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+
+    // Дерево из длинной цепочки конкатенаций разрушается без рекурсии
+    ~Node() {
+        std::vector<std::shared_ptr<const Node>> pending;
+        auto release = [&pending](std::shared_ptr<const Node>& node) {
+            if (node && node.use_count() == 1) {
+                pending.push_back(std::move(node));
+            }
+            node.reset();
+        };
+        release(left);
+        release(right);
+        while (!pending.empty()) {
+            std::shared_ptr<const Node> node = std::move(pending.back());
+            pending.pop_back();
+            release(node->left);
+            release(node->right);
+        }
     }
-    if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
-        return lhs.TryAs<String>()->GetValue() == rhs.TryAs<String>()->GetValue();
+
+    // Вызывает action для непрерывных частей строки в порядке их следования
+    template <typename Action>
+    void ForEachPart(Action action) const {
+        std::vector<const Node*> pending{this};
+        while (!pending.empty()) {
+            const Node* node = pending.back();
+            pending.pop_back();
+            if (node->left) {
+                pending.push_back(node->right.get());
+                pending.push_back(node->left.get());
+            }
+            else {
+                action(node->value);
+            }
+        }
     }
-    if (lhs.TryAs<ClassInstance>() && rhs.TryAs<ClassInstance>()) {
-        return lhs.TryAs<ClassInstance>()->Call(EQ_METHOD, { rhs }, context).TryAs<Bool>()->GetValue();
+
+    const std::string& GetValue() const {
+        if (left) {
+            charge.Resize(sizeof(Node) + size);
+            std::string result;
+            result.reserve(size);
+            ForEachPart([&result](const std::string& part) {
+                result += part;
+            });
+            value = std::move(result);
+            left.reset();
+            right.reset();
+        }
+        return value;
     }
-    if (!lhs && !rhs) {
-        return true;
+
+    const size_t size;
+    mutable std::string value;
+    mutable std::shared_ptr<const Node> left;
+    mutable std::shared_ptr<const Node> right;
+    mutable MemoryCharge charge; // Учтённый размер узла и его содержимого
+};
+
+String::String(std::string value)
+    : Object(ObjectType::String)
+    , value_(std::move(value))
+    , charge_(value_.size())
+{ /* do nothing */ }
+
+String::String(std::shared_ptr<const Node> rope)
+    : Object(ObjectType::String)
+    , rope_(std::move(rope))
+{ /* do nothing */ }
+
+String String::Concat(const String& lhs, const String& rhs) {
+    if (lhs.GetSize() + rhs.GetSize() < ROPE_THRESHOLD) {
+        return String(lhs.GetValue() + rhs.GetValue());
     }
 
-    throw std::runtime_error("Trying to compare wrong object types"s);
+    // Непрерывная строка копируется в лист один раз, дальше лист разделяется конкатенациями
+    auto to_node = [](const String& str) {
+        return str.rope_ ? str.rope_ : std::make_shared<const Node>(str.value_);
+    };
+    return String(std::make_shared<const Node>(to_node(lhs), to_node(rhs)));
 }
 
-bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
-    if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
-        return lhs.TryAs<Bool>()->GetValue() < rhs.TryAs<Bool>()->GetValue();
+void String::Print(std::ostream& os, [[maybe_unused]] Context& context) {
+    if (!rope_) {
+        os << value_;
+        return;
     }
-    if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
-        return lhs.TryAs<Number>()->GetValue() < rhs.TryAs<Number>()->GetValue();
+    rope_->ForEachPart([&os](const std::string& part) {
+        os << part;
+    });
+}
+
+const std::string& String::GetValue() const {
+    return rope_ ? rope_->GetValue() : value_;
+}
+
+size_t String::GetSize() const {
+    return rope_ ? rope_->size : value_.size();
+}
+
+bool String::IsFlat() const {
+    return !rope_ || !rope_->left;
+}
+
+void Bool::Print(std::ostream& os, [[maybe_unused]] Context& context) {
+    os << (GetValue() ? "True"sv : "False"sv);
+}
+
+namespace {
+// Сравнивает значения объектов-значений одного типа type функцией cmp
+template <typename Comparator>
+bool CompareValues(ObjectType type, const ObjectHolder& lhs, const ObjectHolder& rhs,
+                   Comparator cmp) {
+    switch (type) {
+    case ObjectType::Bool:
+        return cmp(static_cast<const Bool*>(lhs.Get())->GetValue(),
+                   static_cast<const Bool*>(rhs.Get())->GetValue());
+    case ObjectType::Number:
+        return cmp(static_cast<const Number*>(lhs.Get())->GetValue(),
+                   static_cast<const Number*>(rhs.Get())->GetValue());
+    case ObjectType::String:
+        return cmp(static_cast<const String*>(lhs.Get())->GetValue(),
+                   static_cast<const String*>(rhs.Get())->GetValue());
+    default:
+        throw std::runtime_error("Trying to compare wrong object types"s);
+    }
+}
+}  // namespace
+
+bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    const ObjectType type = lhs.GetType();
+    if (type != rhs.GetType()) {
+        throw std::runtime_error("Trying to compare wrong object types"s);
     }
-    if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
-        return lhs.TryAs<String>()->GetValue() < rhs.TryAs<String>()->GetValue();
+
+    switch (type) {
+    case ObjectType::None:
+        return true;
+    case ObjectType::ClassInstance: {
+        auto* instance = static_cast<ClassInstance*>(lhs.Get());
+        const Method* eq = instance->GetSpecialMethod(SpecialMethod::Eq, 1);
+        if (eq == nullptr) {
+            throw std::runtime_error("Method __eq__ wasn't found in class "s
+                                     + instance->GetClass().GetName());
+        }
+        return instance->Call(*eq, { rhs }, context).TryAs<Bool>()->GetValue();
     }
-    if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod(LT_METHOD, 1)) {
-        return lhs.TryAs<ClassInstance>()->Call(LT_METHOD, { rhs }, context).TryAs<Bool>()->GetValue();
+    default:
+        return CompareValues(type, lhs, rhs, std::equal_to<>());
     }
+}
+
+bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
+    const ObjectType type = lhs.GetType();
 
-    throw std::runtime_error("Trying to compare wrong object types"s);
+    if (type == ObjectType::ClassInstance) {
+        auto* instance = static_cast<ClassInstance*>(lhs.Get());
+        if (const Method* lt = instance->GetSpecialMethod(SpecialMethod::Lt, 1)) {
+            return instance->Call(*lt, { rhs }, context).TryAs<Bool>()->GetValue();
+        }
+    }
+    if (type != rhs.GetType()) {
+        throw std::runtime_error("Trying to compare wrong object types"s);
+    }
+    return CompareValues(type, lhs, rhs, std::less<>());
 }
 
 bool NotEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
@@ -185,15 +585,79 @@ bool NotEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context
 }
 
 bool Greater(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
-    return !Less(lhs, rhs, context) && NotEqual(lhs, rhs, context);
+    return Less(rhs, lhs, context);
 }
 
 bool LessOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
-    return !Greater(lhs, rhs, context);
+    return !Less(rhs, lhs, context);
 }
 
 bool GreaterOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context) {
     return !Less(lhs, rhs, context);
 }
 
+bool Compare(Comparator comparator, const ObjectHolder& lhs, const ObjectHolder& rhs,
+             Context& context) {
+    switch (comparator) {
+    case Comparator::Equal:
+        return Equal(lhs, rhs, context);
+    case Comparator::NotEqual:
+        return NotEqual(lhs, rhs, context);
+    case Comparator::Less:
+        return Less(lhs, rhs, context);
+    case Comparator::Greater:
+        return Greater(lhs, rhs, context);
+    case Comparator::LessOrEqual:
+        return LessOrEqual(lhs, rhs, context);
+    case Comparator::GreaterOrEqual:
+        return GreaterOrEqual(lhs, rhs, context);
+    }
+    throw std::runtime_error("Unknown comparison"s);
+}
+
+ObjectHolder Arithmetic(ArithmeticOperation operation, const ObjectHolder& lhs,
+                        const ObjectHolder& rhs) {
+    static constexpr const char* OPERATION_NAMES[] = {"Substract", "Multiply", "Divide"};
+    if (lhs.GetType() != ObjectType::Number || rhs.GetType() != ObjectType::Number) {
+        throw std::runtime_error("Attemp to "s + OPERATION_NAMES[static_cast<size_t>(operation)]
+                                 + " wrong object types"s);
+    }
+
+    const int lhs_value = static_cast<const Number*>(lhs.Get())->GetValue();
+    const int rhs_value = static_cast<const Number*>(rhs.Get())->GetValue();
+    switch (operation) {
+    case ArithmeticOperation::Sub:
+        return ObjectHolder::Own(Number(lhs_value - rhs_value));
+    case ArithmeticOperation::Mult:
+        return ObjectHolder::Own(Number(lhs_value * rhs_value));
+    case ArithmeticOperation::Div:
+        if (rhs_value == 0) {
+            throw std::runtime_error("Division by zero"s);
+        }
+        return ObjectHolder::Own(Number(lhs_value / rhs_value));
+    }
+    throw std::runtime_error("Unknown arithmetic operation"s);
+}
+
+ObjectHolder AddValues(const ObjectHolder& lhs, const ObjectHolder& rhs) {
+    const ObjectType rhs_type = rhs.GetType();
+    switch (lhs.GetType()) {
+    case ObjectType::Number:
+        if (rhs_type == ObjectType::Number) {
+            return ObjectHolder::Own(Number(static_cast<const Number*>(lhs.Get())->GetValue()
+                                            + static_cast<const Number*>(rhs.Get())->GetValue()));
+        }
+        break;
+    case ObjectType::String:
+        if (rhs_type == ObjectType::String) {
+            return ObjectHolder::Own(String::Concat(*static_cast<const String*>(lhs.Get()),
+                                                    *static_cast<const String*>(rhs.Get())));
+        }
+        break;
+    default:
+        break;
+    }
+    throw std::runtime_error("Attemp to Add wrong object types"s);
+}
+
 }  // namespace runtime
@@ -1,46 +1,283 @@
 #pragma once
 
+#include "memory.h"
+#include "pool.h"
+#include "symbol.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <new>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
 namespace runtime {
 
+class ObjectHolder;
+class GarbageCollector;
+
 // Контекст исполнения инструкций Mython
 class Context {
 public:
     // Возвращает поток вывода для команд print
     virtual std::ostream& GetOutputStream() = 0;
 
+    // Возвращает кадр выполняемого метода либо nullptr, если метод не использует кадр
+    [[nodiscard]] Frame* GetFrame() const {
+        return frame_;
+    }
+
+    // Делает frame кадром выполняемого метода, возвращает предыдущий кадр
+    Frame* SetFrame(Frame* frame) {
+        Frame* prev = frame_;
+        frame_ = frame;
+        return prev;
+    }
+
+    // Возвращает true, если выполнена инструкция return и выполняемый метод
+    // должен завершиться
+    [[nodiscard]] bool IsReturning() const {
+        return returning_;
+    }
+
+    // Устанавливает либо сбрасывает признак выполненной инструкции return
+    void SetReturning(bool returning) {
+        returning_ = returning;
+    }
+
+    // Возвращает счёт памяти программы, исполняемой в контексте.
+    // Через него задаётся лимит памяти и читается статистика её использования
+    [[nodiscard]] MemoryAccount& GetMemory() {
+        return memory_;
+    }
+
 protected:
     ~Context() = default;
+
+private:
+    Frame* frame_ = nullptr;
+    bool returning_ = false;
+    MemoryAccount memory_;
+};
+
+// Устанавливает кадр метода на время своего существования
+class FrameScope {
+public:
+    FrameScope(Context& context, Frame* frame)
+        : context_(context)
+        , prev_(context.SetFrame(frame)) {
+    }
+
+    FrameScope(const FrameScope&) = delete;
+    FrameScope& operator=(const FrameScope&) = delete;
+
+    ~FrameScope() {
+        context_.SetFrame(prev_);
+    }
+
+private:
+    Context& context_;
+    Frame* prev_;
+};
+
+// Тип объекта Mython. Позволяет проверять тип объекта без dynamic_cast
+enum class ObjectType : std::uint8_t {
+    None,          // Пустое значение (возвращается только ObjectHolder::GetType)
+    Other,         // Объект, тип которого не известен среде исполнения
+    Number,
+    String,
+    Bool,
+    Class,
+    ClassInstance,
 };
 
 // Базовый класс для всех объектов языка Mython
 class Object {
 public:
+    Object() = default;
+    // Копия объекта получает собственный счётчик ссылок
+    Object(const Object& other) noexcept
+        : type_(other.type_) {
+    }
+    // Присваивание не изменяет ни тип объекта, ни счётчик ссылок на него
+    Object& operator=(const Object& /*other*/) noexcept {
+        return *this;
+    }
     virtual ~Object() = default;
+
+    // Объекты в куче размещаются в пуле ObjectPool потока, создающего объект,
+    // и учитываются в текущем счёте памяти этого потока. Заголовок перед объектом хранит
+    // этот счёт, поэтому при освобождении память возвращается в него
+    static void* operator new(std::size_t size);
+    static void* operator new(std::size_t /*size*/, void* place) noexcept {
+        return place;
+    }
+    static void operator delete(void* ptr, std::size_t size) noexcept;
+
     // выводит в os своё представление в виде строки
     virtual void Print(std::ostream& os, Context& context) = 0;
+
+    // Возвращает тип объекта
+    [[nodiscard]] ObjectType GetType() const {
+        return type_;
+    }
+
+    // Возвращает число владеющих ObjectHolder, ссылающихся на объект.
+    // Для объектов, не созданных через ObjectHolder::Own, возвращает 0
+    [[nodiscard]] std::uint32_t GetRefCount() const {
+        return ref_count_;
+    }
+
+protected:
+    explicit Object(ObjectType type)
+        : type_(type) {
+    }
+
+private:
+    friend class ObjectHolder;
+
+    // Счётчик ссылок хранится в самом объекте и изменяется без атомарных операций:
+    // объекты Mython используются только потоком, исполняющим программу
+    std::uint32_t ref_count_ = 0;
+    ObjectType type_ = ObjectType::Other;
+};
+
+// Тип объекта, соответствующий значению типа T внутри ValueObject
+template <typename T>
+inline constexpr ObjectType VALUE_OBJECT_TYPE = ObjectType::Other;
+template <>
+inline constexpr ObjectType VALUE_OBJECT_TYPE<int> = ObjectType::Number;
+
+// Объект-значение, хранящий значение типа T
+template <typename T>
+class ValueObject : public Object {
+public:
+    ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+        : Object(VALUE_OBJECT_TYPE<T>)
+        , value_(v) {
+    }
+
+    void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
+        os << value_;
+    }
+
+    [[nodiscard]] const T& GetValue() const {
+        return value_;
+    }
+
+protected:
+    ValueObject(T v, ObjectType type)
+        : Object(type)
+        , value_(v) {
+    }
+
+private:
+    T value_;
 };
 
-// Специальный класс-обёртка, предназначенный для хранения объекта в Mython-программе
+/*
+ * Строковое значение.
+ * Конкатенация длинных строк (Concat) не копирует содержимое операндов, а строит дерево
+ * частей (rope), разделяемое с операндами. Части объединяются в непрерывную строку
+ * при первом обращении к GetValue, вывод строки обходит части без объединения
+ */
+class String : public Object {
+public:
+    // Строки, суммарная длина которых меньше порога, конкатенируются копированием
+    static constexpr size_t ROPE_THRESHOLD = 64;
+
+    String(std::string value);  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+
+    // Возвращает строку, равную конкатенации lhs и rhs
+    [[nodiscard]] static String Concat(const String& lhs, const String& rhs);
+
+    void Print(std::ostream& os, Context& context) override;
+
+    // Возвращает содержимое строки, объединяя её части при первом обращении
+    [[nodiscard]] const std::string& GetValue() const;
+
+    // Возвращает длину строки без объединения её частей
+    [[nodiscard]] size_t GetSize() const;
+
+    // Возвращает true, если содержимое строки хранится непрерывно
+    [[nodiscard]] bool IsFlat() const;
+
+private:
+    struct Node;
+
+    String(std::shared_ptr<const Node> rope);
+
+    std::string value_;                // Содержимое строки, не хранящейся деревом
+    std::shared_ptr<const Node> rope_; // Дерево частей длинной строки либо nullptr
+    MemoryCharge charge_;              // Учтённый размер value_
+};
+
+// Числовое значение
+using Number = ValueObject<int>;
+
+// Логическое значение
+class Bool : public ValueObject<bool> {
+public:
+    Bool(bool v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+        : ValueObject<bool>(v, ObjectType::Bool) {
+    }
+
+    void Print(std::ostream& os, Context& context) override;
+};
+
+/*
+ * Специальный класс-обёртка, предназначенный для хранения объекта в Mython-программе.
+ * Числа и логические значения, созданные через Own, хранятся непосредственно внутри
+ * ObjectHolder и не требуют выделения памяти в куче. Остальные объекты хранятся в куче,
+ * и временем их жизни управляет счётчик ссылок внутри Object.
+ */
 class ObjectHolder {
 public:
     // Создаёт пустое значение
-    ObjectHolder() = default;
+    ObjectHolder() noexcept {
+    }
+
+    ObjectHolder(const ObjectHolder& other);
+    ObjectHolder(ObjectHolder&& other) noexcept;
+    ObjectHolder& operator=(const ObjectHolder& other);
+    ObjectHolder& operator=(ObjectHolder&& other) noexcept;
+    ~ObjectHolder();
 
     // Возвращает ObjectHolder, владеющий объектом типа T
     // Тип T - конкретный класс-наследник Object.
-    // object копируется или перемещается в кучу
+    // Number и Bool копируются внутрь ObjectHolder, остальные объекты копируются
+    // или перемещаются в кучу
     template <typename T>
     [[nodiscard]] static ObjectHolder Own(T&& object) {
-        return ObjectHolder(std::make_shared<T>(std::forward<T>(object)));
+        using Type = std::decay_t<T>;
+
+        ObjectHolder result;
+        if constexpr (std::is_same_v<Type, Number>) {
+            new (&result.number_) Number(std::forward<T>(object));
+            result.tag_ = Tag::Number;
+        }
+        else if constexpr (std::is_same_v<Type, Bool>) {
+            new (&result.bool_) Bool(std::forward<T>(object));
+            result.tag_ = Tag::Bool;
+        }
+        else {
+            result.object_ = new Type(std::forward<T>(object));
+            result.object_->ref_count_ = 1;
+            result.tag_ = Tag::Heap;
+        }
+        return result;
     }
 
-    // Создаёт ObjectHolder, не владеющий объектом (аналог слабой ссылки)
+    // Создаёт ObjectHolder, не владеющий объектом (аналог слабой ссылки).
+    // Заимствованная ссылка не изменяет счётчик ссылок объекта и не выделяет память.
+    // Копии заимствованной ссылки на объект, созданный через Own, владеют объектом
     [[nodiscard]] static ObjectHolder Share(Object& object);
     // Создаёт пустой ObjectHolder, соответствующий значению None
     [[nodiscard]] static ObjectHolder None();
@@ -53,45 +290,220 @@ public:
 
     [[nodiscard]] Object* Get() const;
 
+    // Возвращает тип хранимого объекта либо ObjectType::None для пустого значения
+    [[nodiscard]] ObjectType GetType() const;
+
     // Возвращает указатель на объект типа T либо nullptr, если внутри ObjectHolder не хранится
-    // объект данного типа
+    // объект данного типа. Для типов среды исполнения проверяется тип объекта,
+    // для остальных типов применяется dynamic_cast
     template <typename T>
-    [[nodiscard]] T* TryAs() const {
-        return dynamic_cast<T*>(this->Get());
-    }
+    [[nodiscard]] T* TryAs() const;
 
     // Возвращает true, если ObjectHolder не пуст
     explicit operator bool() const;
 
+    // Возвращает true, если ObjectHolder ссылается на объект, не владея им
+    [[nodiscard]] bool IsBorrowed() const {
+        return tag_ == Tag::Borrowed;
+    }
+
 private:
-    explicit ObjectHolder(std::shared_ptr<Object> data);
-    void AssertIsValid() const;
+    // Вид значения, хранящегося в ObjectHolder
+    enum class Tag : std::uint8_t {
+        None,   // Пустое значение
+        Number, // Число в number_
+        Bool,   // Логическое значение в bool_
+        Heap,     // Объект в куче, которым ObjectHolder владеет через счётчик ссылок в object_
+        Borrowed, // Объект, на который указывает object_, без владения им
+    };
 
-    std::shared_ptr<Object> data_;
+    void AssertIsValid() const;
+    // Разрушает хранимое значение, делая ObjectHolder пустым
+    void Reset() noexcept;
+
+    union {
+        Number number_;
+        Bool bool_;
+        Object* object_;
+    };
+    Tag tag_ = Tag::None;
 };
 
-// Объект-значение, хранящий значение типа T
-template <typename T>
-class ValueObject : public Object {
+// Конструкторы копирования и перемещения присваивают значение пустому ObjectHolder
+inline ObjectHolder::ObjectHolder(const ObjectHolder& other) {
+    *this = other;
+}
+
+inline ObjectHolder::ObjectHolder(ObjectHolder&& other) noexcept {
+    *this = std::move(other);
+}
+
+// Операторы присваивания извлекают значение other до разрушения текущего значения:
+// other может принадлежать объекту, которым владеет *this. Значение читается из члена
+// объединения, выбранного по tag_, без промежуточного ObjectHolder
+inline ObjectHolder& ObjectHolder::operator=(const ObjectHolder& other) {
+    switch (other.tag_) {
+    case Tag::None:
+        Reset();
+        break;
+    case Tag::Number: {
+        const int value = other.number_.GetValue();
+        Reset();
+        new (&number_) Number(value);
+        tag_ = Tag::Number;
+        break;
+    }
+    case Tag::Bool: {
+        const bool value = other.bool_.GetValue();
+        Reset();
+        new (&bool_) Bool(value);
+        tag_ = Tag::Bool;
+        break;
+    }
+    case Tag::Heap:
+    case Tag::Borrowed: {
+        Object* object = other.object_;
+        // Копия заимствованной ссылки на объект, которым владеют ObjectHolder, тоже владеет им.
+        // Поэтому self, сохранённый в переменной или поле, не переживает свой объект
+        const bool owning = other.tag_ == Tag::Heap || object->ref_count_ > 0;
+        if (owning) {
+            ++object->ref_count_;
+        }
+        Reset();
+        object_ = object;
+        tag_ = owning ? Tag::Heap : Tag::Borrowed;
+        break;
+    }
+    }
+    return *this;
+}
+
+inline ObjectHolder& ObjectHolder::operator=(ObjectHolder&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    switch (other.tag_) {
+    case Tag::None:
+        Reset();
+        break;
+    case Tag::Number: {
+        const int value = other.number_.GetValue();
+        other.Reset();
+        Reset();
+        new (&number_) Number(value);
+        tag_ = Tag::Number;
+        break;
+    }
+    case Tag::Bool: {
+        const bool value = other.bool_.GetValue();
+        other.Reset();
+        Reset();
+        new (&bool_) Bool(value);
+        tag_ = Tag::Bool;
+        break;
+    }
+    case Tag::Heap:
+    case Tag::Borrowed: {
+        // Владение переходит к *this без изменения счётчика ссылок
+        Object* object = other.object_;
+        const Tag tag = other.tag_;
+        other.tag_ = Tag::None;
+        Reset();
+        object_ = object;
+        tag_ = tag;
+        break;
+    }
+    }
+    return *this;
+}
+
+inline ObjectHolder::~ObjectHolder() {
+    Reset();
+}
+
+inline void ObjectHolder::Reset() noexcept {
+    switch (tag_) {
+    case Tag::None:
+        break;
+    case Tag::Number:
+        number_.~Number();
+        break;
+    case Tag::Bool:
+        bool_.~Bool();
+        break;
+    case Tag::Heap:
+        if (--object_->ref_count_ == 0) {
+            delete object_;
+        }
+        break;
+    case Tag::Borrowed:
+        break;
+    }
+    tag_ = Tag::None;
+}
+
+inline Object* ObjectHolder::Get() const {
+    switch (tag_) {
+    case Tag::Number:
+        return const_cast<Number*>(&number_);
+    case Tag::Bool:
+        return const_cast<Bool*>(&bool_);
+    case Tag::Heap:
+    case Tag::Borrowed:
+        return object_;
+    case Tag::None:
+        break;
+    }
+    return nullptr;
+}
+
+inline ObjectType ObjectHolder::GetType() const {
+    switch (tag_) {
+    case Tag::Number:
+        return ObjectType::Number;
+    case Tag::Bool:
+        return ObjectType::Bool;
+    case Tag::Heap:
+    case Tag::Borrowed:
+        return object_->GetType();
+    case Tag::None:
+        break;
+    }
+    return ObjectType::None;
+}
+
+inline ObjectHolder::operator bool() const {
+    return tag_ != Tag::None;
+}
+
+// Кадр, полученный из FramePool и возвращаемый в него при разрушении
+class PooledFrame {
 public:
-    ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
-        : value_(v) {
+    explicit PooledFrame(size_t size)
+        : frame_(FramePool::Acquire(size)) {
     }
 
-    void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
-        os << value_;
+    PooledFrame(const PooledFrame&) = delete;
+    PooledFrame& operator=(const PooledFrame&) = delete;
+
+    ~PooledFrame() {
+        FramePool::Release(std::move(frame_));
     }
 
-    [[nodiscard]] const T& GetValue() const {
-        return value_;
+    Frame& operator*() {
+        return frame_;
+    }
+
+    Frame* operator->() {
+        return &frame_;
     }
 
 private:
-    T value_;
+    Frame frame_;
 };
 
 // Таблица символов, связывающая имя объекта с его значением
-using Closure = std::unordered_map<std::string, ObjectHolder>;
+using Closure = std::unordered_map<Symbol, ObjectHolder>;
 
 // Проверяет, содержится ли в object значение, приводимое к True
 // Для отличных от нуля чисел, True и непустых строк возвращается true. В остальных случаях - false.
@@ -104,57 +516,252 @@ public:
     // Выполняет действие над объектами внутри closure, используя context
     // Возвращает результирующее значение либо None
     virtual ObjectHolder Execute(Closure& closure, Context& context) = 0;
+
+    // Объект размещается в арене, установленной в текущем потоке ArenaScope, либо в куче.
+    // Память объекта из арены освобождается только вместе с ареной
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr) noexcept;
 };
 
-// Строковое значение
-using String = ValueObject<std::string>;
-// Числовое значение
-using Number = ValueObject<int>;
+struct Method;
 
-// Логическое значение
-class Bool : public ValueObject<bool> {
+// Тело метода, разбор которого отложен до первого вызова метода
+class DeferredBody {
 public:
-    using ValueObject<bool>::ValueObject;
+    // Преобразование построенного тела метода
+    using Transform = std::function<void(std::unique_ptr<Executable>&)>;
 
-    void Print(std::ostream& os, Context& context) override;
+    virtual ~DeferredBody() = default;
+
+    // Строит тело метода method и вычисляет размер его кадра.
+    // При ошибке разбора выбрасывает исключение, не изменяя метод
+    virtual void Parse(Method& method) const = 0;
+
+    // Добавляет преобразование, применяемое к телу сразу после его разбора
+    void AddTransform(Transform transform) {
+        transforms_.push_back(std::move(transform));
+    }
+
+    [[nodiscard]] const std::vector<Transform>& GetTransforms() const {
+        return transforms_;
+    }
+
+private:
+    std::vector<Transform> transforms_;
 };
 
 // Метод класса
 struct Method {
     // Имя метода
-    std::string name;
+    Symbol name;
     // Имена формальных параметров метода
-    std::vector<std::string> formal_params;
+    std::vector<Symbol> formal_params;
     // Тело метода
     std::unique_ptr<Executable> body;
+    // Размер кадра вызова (self, параметры и локальные переменные), вычисленный при разборе.
+    // Если равен нулю, переменные метода хранятся в Closure
+    size_t frame_size = 0;
+    // Отложенный разбор тела. Пока не равен nullptr, body и frame_size не заполнены
+    std::unique_ptr<DeferredBody> deferred_body = nullptr;
+
+    // Строит тело метода, если его разбор был отложен.
+    // Вызывается перед обращением к body и frame_size вызываемого метода
+    void Prepare() const {
+        if (deferred_body) {
+            ParseDeferredBody();
+        }
+    }
+
+    // Разбирает отложенное тело и применяет к нему преобразования
+    void ParseDeferredBody() const;
+};
+
+/*
+ * Форма (скрытый класс) экземпляров: упорядоченный набор имён полей.
+ * Экземпляры одного класса, получившие поля в одном и том же порядке, разделяют форму
+ * и хранят значения полей в массиве по смещениям, заданным формой.
+ * Формы образуют дерево переходов, корнем которого является пустая форма класса
+ */
+class Shape {
+public:
+    static constexpr size_t NO_FIELD = static_cast<size_t>(-1);
+
+    // Возвращает смещение поля name либо NO_FIELD, если поле отсутствует
+    [[nodiscard]] size_t FindOffset(Symbol name) const;
+
+    // Возвращает форму, получающуюся добавлением поля name в конец текущей формы
+    [[nodiscard]] const Shape* AddField(Symbol name) const;
+
+    // Возвращает имена полей в порядке их смещений
+    [[nodiscard]] const std::vector<Symbol>& GetFieldNames() const {
+        return names_;
+    }
+
+private:
+    std::vector<Symbol> names_;
+    std::unordered_map<Symbol, size_t> offsets_;
+    mutable std::unordered_map<Symbol, std::unique_ptr<Shape>> transitions_;
+};
+
+// Кэш места доступа к полю: смещение поля для последней встреченной формы объекта
+struct FieldCache {
+    const Shape* shape = nullptr;      // Форма, для которой действительна запись
+    const Shape* next_shape = nullptr; // Форма после добавления поля при записи, либо nullptr
+    size_t offset = 0;                 // Смещение поля
+};
+
+// Идентификатор имени метода, единый для всех классов процесса
+using MethodId = std::uint32_t;
+
+// Возвращает идентификатор имени метода name, регистрируя имя при первом обращении.
+// Функцию можно вызывать из нескольких потоков
+MethodId InternMethodName(Symbol name);
+
+// Специальные методы, для которых класс хранит заранее найденные слоты
+enum class SpecialMethod : std::uint8_t {
+    Str,  // __str__
+    Eq,   // __eq__
+    Lt,   // __lt__
+    Add,  // __add__
+    Init, // __init__
+    Count
 };
 
 // Класс
 class Class : public Object {
 public:
     // Создаёт класс с именем name и набором методов methods, унаследованный от класса parent
-    // Если parent равен nullptr, то создаётся базовый класс
-    explicit Class(std::string name, std::vector<Method> methods, const Class* parent);
+    // Если parent равен nullptr, то создаётся базовый класс.
+    // storage - владелец памяти, в которой размещены тела методов (например, арена программы).
+    // Класс продлевает время его жизни до своего разрушения
+    explicit Class(std::string name, std::vector<Method> methods, const Class* parent,
+                   std::shared_ptr<const void> storage = nullptr);
 
     // Возвращает указатель на метод name или nullptr, если метод с таким именем отсутствует
-    [[nodiscard]] const Method* GetMethod(const std::string& name) const;
+    [[nodiscard]] const Method* GetMethod(Symbol name) const;
+
+    // Возвращает указатель на метод с идентификатором id или nullptr.
+    // Таблица методов с учётом наследования строится при создании класса и содержит
+    // только методы класса и его предков, поэтому её размер не зависит от числа
+    // зарегистрированных в процессе имён
+    [[nodiscard]] const Method* GetMethod(MethodId id) const {
+        auto it = std::lower_bound(method_table_.begin(), method_table_.end(), id,
+                                   [](const MethodEntry& entry, MethodId id) {
+                                       return entry.id < id;
+                                   });
+        return it != method_table_.end() && it->id == id ? it->method : nullptr;
+    }
+
+    // Возвращает специальный метод method или nullptr, если класс его не содержит
+    [[nodiscard]] const Method* GetSpecialMethod(SpecialMethod method) const {
+        return special_methods_[static_cast<size_t>(method)];
+    }
 
     // Возвращает имя класса
     [[nodiscard]] const std::string& GetName() const;
 
+    // Возвращает базовый класс либо nullptr, если класс не унаследован от другого
+    [[nodiscard]] const Class* GetParent() const {
+        return parent_;
+    }
+
+    // Вызывает visit(const Method&) для каждого собственного метода класса
+    template <typename Visit>
+    void ForEachMethod(Visit visit) const {
+        for (const auto& [name, method] : names_to_methods_) {
+            visit(method);
+        }
+    }
+
+    // Вызывает transform(std::unique_ptr<Executable>&) для тела каждого собственного метода.
+    // Предназначен для преобразования программы до начала её выполнения.
+    // Тела, разбор которых отложен, преобразуются сразу после разбора
+    template <typename Transform>
+    void TransformMethodBodies(Transform transform) {
+        for (auto& [name, method] : names_to_methods_) {
+            if (method.deferred_body) {
+                method.deferred_body->AddTransform(transform);
+            }
+            else {
+                transform(method.body);
+            }
+        }
+    }
+
+    // Возвращает пустую форму, с которой начинают новые экземпляры класса
+    [[nodiscard]] const Shape* GetRootShape() const {
+        return root_shape_.get();
+    }
+
     // Выводит в os строку "Class <имя класса>", например "Class cat"
     void Print(std::ostream& os, Context& context) override;
 
 private:
+    struct MethodEntry {
+        MethodId id;
+        const Method* method;
+    };
+
     std::string name_;              // Имя класса
     const Class* parent_ = nullptr; // Указатель на базовый класс
-    std::unordered_map<std::string, Method> names_to_methods_; // Таблица методов
+    std::shared_ptr<const void> storage_; // Память тел методов, разрушается после методов
+    std::unordered_map<Symbol, Method> names_to_methods_; // Таблица методов
+    // Методы класса и его предков, упорядоченные по идентификаторам имён
+    std::vector<MethodEntry> method_table_;
+    // Слоты специальных методов
+    std::array<const Method*, static_cast<size_t>(SpecialMethod::Count)> special_methods_{};
+    std::unique_ptr<Shape> root_shape_ = std::make_unique<Shape>(); // Корень дерева форм
+};
+
+/*
+ * Полиморфный встроенный кэш места вызова метода: хранит результаты поиска метода
+ * для нескольких последних классов получателя. Классы не изменяются после создания,
+ * поэтому кэшируется и отсутствие метода.
+ * Если в месте вызова встречается больше классов, чем помещается в кэш,
+ * метод ищется без кэширования
+ */
+class MethodCache {
+public:
+    static constexpr size_t CAPACITY = 4;
+
+    // Возвращает метод с идентификатором id класса cls либо nullptr, если метод отсутствует
+    const Method* Lookup(const Class& cls, MethodId id) {
+        for (size_t i = 0; i < size_; ++i) {
+            if (entries_[i].cls == &cls) {
+                return entries_[i].method;
+            }
+        }
+
+        const Method* method = cls.GetMethod(id);
+        if (size_ < CAPACITY) {
+            entries_[size_++] = {&cls, method};
+        }
+        return method;
+    }
+
+    // Возвращает количество закэшированных классов
+    [[nodiscard]] size_t GetSize() const {
+        return size_;
+    }
+
+private:
+    struct Entry {
+        const Class* cls = nullptr;
+        const Method* method = nullptr;
+    };
+
+    Entry entries_[CAPACITY];
+    size_t size_ = 0;
 };
 
 // Экземпляр класса
 class ClassInstance : public Object {
 public:
     explicit ClassInstance(const Class& cls);
+    // Перемещённый объект отслеживается сборщиком текущего потока наравне с новым
+    ClassInstance(ClassInstance&& other) noexcept;
+    ClassInstance& operator=(const ClassInstance&) = delete;
+    ~ClassInstance() override;
 
     /*
      * Если у объекта есть метод __str__, выводит в os результат, возвращённый этим методом.
@@ -168,20 +775,60 @@ public:
      * Если ни сам класс, ни его родители не содержат метод method, метод выбрасывает исключение
      * runtime_error
      */
-    ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args,
+    ObjectHolder Call(Symbol method, const std::vector<ObjectHolder>& actual_args,
+                      Context& context);
+
+    // Вызывает у объекта заранее найденный метод method его класса.
+    // Количество actual_args должно совпадать с количеством формальных параметров метода
+    ObjectHolder Call(const Method& method, const std::vector<ObjectHolder>& actual_args,
                       Context& context);
 
+    // Вызывает метод method, использующий кадр, в кадре frame размера method.frame_size.
+    // Слоты параметров frame должны содержать аргументы вызова, слот self заполняется методом.
+    // Тело метода должно быть построено вызовом method.Prepare()
+    ObjectHolder CallWithFrame(const Method& method, Frame& frame, Context& context);
+
     // Возвращает true, если объект имеет метод method, принимающий argument_count параметров
-    [[nodiscard]] bool HasMethod(const std::string& method, size_t argument_count) const;
+    [[nodiscard]] bool HasMethod(Symbol method, size_t argument_count) const;
+
+    // Возвращает специальный метод method, принимающий argument_count параметров, либо nullptr
+    [[nodiscard]] const Method* GetSpecialMethod(SpecialMethod method,
+                                                 size_t argument_count) const {
+        const Method* result = cls_.GetSpecialMethod(method);
+        return result != nullptr && result->formal_params.size() == argument_count ? result
+                                                                                   : nullptr;
+    }
+
+    // Возвращает класс, экземпляром которого является объект
+    [[nodiscard]] const Class& GetClass() const;
 
-    // Возвращает ссылку на Closure, содержащий поля объекта
+    // Возвращает указатель на значение поля name либо nullptr, если поле отсутствует.
+    // cache - кэш места доступа к полю с именем name, обновляемый при промахе
+    [[nodiscard]] ObjectHolder* FindField(Symbol name, FieldCache& cache);
+
+    // Присваивает полю name значение value, добавляя поле при его отсутствии.
+    // Возвращает ссылку на присвоенное значение, действительную до следующего изменения полей
+    ObjectHolder& SetField(Symbol name, ObjectHolder value, FieldCache& cache);
+
+    // Возвращает ссылку на Closure, содержащий поля объекта.
+    // Объект переходит в режим словаря и дальше хранит поля в этом Closure
     [[nodiscard]] Closure& Fields();
     // Возвращает константную ссылку на Closure, содержащую поля объекта
     [[nodiscard]] const Closure& Fields() const;
 
 private:
-    Closure closure_;  // Таблица полей класса
-    const Class& cls_; // Константная ссылка на объект класса
+    friend class GarbageCollector;
+
+    // Переносит поля из массива значений в словарь
+    Closure& ToDictionary() const;
+
+    const Class& cls_;                         // Константная ссылка на объект класса
+    mutable const Shape* shape_;               // Форма объекта; nullptr в режиме словаря
+    mutable std::vector<ObjectHolder> values_; // Значения полей по смещениям формы
+    mutable std::unique_ptr<Closure> fields_;  // Таблица полей в режиме словаря
+    mutable MemoryCharge fields_charge_;       // Учтённый размер хранилища полей
+    GarbageCollector* gc_ = nullptr;           // Сборщик, отслеживающий объект
+    size_t gc_index_ = 0;                      // Позиция объекта в списке сборщика
 };
 
 /*
@@ -205,13 +852,128 @@ bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
 bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
 // Возвращает значение, противоположное Equal(lhs, rhs, context)
 bool NotEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-// Возвращает значение lhs>rhs, используя функции Equal и Less
+/*
+ * Возвращает значение lhs>rhs, вычисленное как Less(rhs, lhs, context): операнды меняются
+ * местами, поэтому для объекта rhs вызывается его метод rhs.__lt__(lhs). Если rhs не является
+ * объектом с методом __lt__, а lhs - является, функция выбрасывает исключение runtime_error:
+ * одного вызова lhs.__lt__ недостаточно, чтобы отличить lhs>rhs от lhs==rhs.
+ * Каждый оператор порядка вызывает не более одного пользовательского метода
+ */
 bool Greater(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-// Возвращает значение lhs<=rhs, используя функции Equal и Less
+// Возвращает значение, противоположное Greater(lhs, rhs, context), то есть !(rhs<lhs)
 bool LessOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
 // Возвращает значение, противоположное Less(lhs, rhs, context)
 bool GreaterOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
 
+// Вид операции сравнения
+enum class Comparator : std::uint8_t {
+    Equal,
+    NotEqual,
+    Less,
+    Greater,
+    LessOrEqual,
+    GreaterOrEqual,
+};
+
+// Сравнивает lhs и rhs операцией comparator
+bool Compare(Comparator comparator, const ObjectHolder& lhs, const ObjectHolder& rhs,
+             Context& context);
+
+// Вид арифметической операции над числами
+enum class ArithmeticOperation : std::uint8_t {
+    Sub,
+    Mult,
+    Div,
+};
+
+// Вычисляет lhs - rhs, lhs * rhs либо lhs / rhs. Выбрасывает исключение runtime_error,
+// если хотя бы один из операндов не является числом или делитель равен нулю
+ObjectHolder Arithmetic(ArithmeticOperation operation, const ObjectHolder& lhs,
+                        const ObjectHolder& rhs);
+
+// Возвращает сумму чисел либо конкатенацию строк lhs и rhs.
+// Для остальных операндов выбрасывает исключение runtime_error
+ObjectHolder AddValues(const ObjectHolder& lhs, const ObjectHolder& rhs);
+
+/*
+ * Операции Add, PrintValue и Stringify общие для всех движков исполнения, но методы
+ * __add__ и __str__ движок вызывает сам: call_method(instance, method) исполняет метод method
+ * объекта instance с аргументами операции и возвращает результат вызова
+ */
+
+// Возвращает lhs + rhs. Если lhs - объект с методом __add__, а rhs не равен None,
+// возвращает результат вызова lhs.__add__(rhs)
+template <typename MethodCaller>
+ObjectHolder Add(const ObjectHolder& lhs, const ObjectHolder& rhs, MethodCaller call_method) {
+    if (lhs.GetType() == ObjectType::ClassInstance && rhs) {
+        auto* instance = static_cast<ClassInstance*>(lhs.Get());
+        if (const Method* add = instance->GetSpecialMethod(SpecialMethod::Add, 1)) {
+            return call_method(*instance, *add);
+        }
+    }
+    return AddValues(lhs, rhs);
+}
+
+// Выводит value в os так, как его выводит команда print: None - как "None",
+// объект с методом __str__ - как результат вызова этого метода
+template <typename MethodCaller>
+void PrintValue(const ObjectHolder& value, std::ostream& os, Context& context,
+                MethodCaller call_method) {
+    if (!value) {
+        os << "None";
+        return;
+    }
+    if (value.GetType() == ObjectType::ClassInstance) {
+        auto* instance = static_cast<ClassInstance*>(value.Get());
+        if (const Method* str = instance->GetSpecialMethod(SpecialMethod::Str, 0)) {
+            PrintValue(call_method(*instance, *str), os, context, call_method);
+            return;
+        }
+    }
+    value->Print(os, context);
+}
+
+// Возвращает строковое представление value, как это делает функция str
+template <typename MethodCaller>
+ObjectHolder Stringify(const ObjectHolder& value, Context& context, MethodCaller call_method) {
+    // Строки неизменяемы, поэтому str от строки возвращает её саму.
+    // Строку, которой ObjectHolder не владеет (например, константу AST), копируем:
+    // копия разделяет с оригиналом части длинной строки
+    if (value.GetType() == ObjectType::String) {
+        return value.IsBorrowed() ? ObjectHolder::Own(*static_cast<String*>(value.Get())) : value;
+    }
+    std::ostringstream ss;
+    PrintValue(value, ss, context, call_method);
+    return ObjectHolder::Own(String(ss.str()));
+}
+
+// Тип объекта, соответствующий классу T. Для классов, не известных среде исполнения,
+// равен ObjectType::Other
+template <typename T>
+inline constexpr ObjectType OBJECT_TYPE_OF = ObjectType::Other;
+template <>
+inline constexpr ObjectType OBJECT_TYPE_OF<Number> = ObjectType::Number;
+template <>
+inline constexpr ObjectType OBJECT_TYPE_OF<String> = ObjectType::String;
+template <>
+inline constexpr ObjectType OBJECT_TYPE_OF<Bool> = ObjectType::Bool;
+template <>
+inline constexpr ObjectType OBJECT_TYPE_OF<Class> = ObjectType::Class;
+template <>
+inline constexpr ObjectType OBJECT_TYPE_OF<ClassInstance> = ObjectType::ClassInstance;
+
+template <typename T>
+T* ObjectHolder::TryAs() const {
+    constexpr ObjectType type = OBJECT_TYPE_OF<std::remove_const_t<T>>;
+
+    if constexpr (type == ObjectType::Other) {
+        return dynamic_cast<T*>(Get());
+    }
+    else {
+        return GetType() == type ? static_cast<T*>(Get()) : nullptr;
+    }
+}
+
 // Контекст-заглушка, применяется в тестах.
 // В этом контексте весь вывод перенаправляется в строковый поток вывода output
 struct DummyContext : Context {
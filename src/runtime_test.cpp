@@ -1,7 +1,10 @@
+#include "arena.h"
+#include "gc.h"
 #include "runtime.h"
 #include "test_runner_p.h"
 
 #include <functional>
+#include <thread>
 
 using namespace std;
 
@@ -19,7 +22,8 @@ public:
     }
 
     Logger(const Logger& rhs)
-        : id_(rhs.id_)  //
+        : Object(rhs)
+        , id_(rhs.id_)  //
     {
         ++instance_count;
     }
@@ -71,6 +75,34 @@ void TestString() {
     ASSERT_EQUAL(word.GetValue(), "hello!"s);
 }
 
+void TestStringConcat() {
+    const String short_result = String::Concat(String("ab"s), String("cd"s));
+    ASSERT(short_result.IsFlat());
+    ASSERT_EQUAL(short_result.GetValue(), "abcd"s);
+
+    // Длинная цепочка конкатенаций не копирует накопленную строку
+    const string piece(String::ROPE_THRESHOLD, 'x');
+    String text(piece);
+    for (int i = 0; i < 100000; ++i) {
+        text = String::Concat(text, String("y"s));
+    }
+    const String prefix = text;
+    text = String::Concat(String("<"s), text);
+    ASSERT(!text.IsFlat());
+    ASSERT_EQUAL(text.GetSize(), piece.size() + 100001);
+
+    DummyContext context;
+    text.Print(context.output, context);
+    ASSERT(!text.IsFlat());
+    ASSERT_EQUAL(context.output.str(), "<"s + piece + string(100000, 'y'));
+
+    ASSERT_EQUAL(text.GetValue(), context.output.str());
+    ASSERT(text.IsFlat());
+    // Объединение частей не изменяет строки, разделяющие эти части
+    ASSERT_EQUAL(prefix.GetSize(), piece.size() + 100000);
+    ASSERT_EQUAL(prefix.GetValue(), piece + string(100000, 'y'));
+}
+
 void TestBool() {
     Bool t(true);
     ASSERT_EQUAL(t.GetValue(), true);
@@ -248,6 +280,103 @@ void TestNullptr() {
     ASSERT(!oh.Get());
 }
 
+void TestInlineValues() {
+    // Числа и логические значения хранятся внутри ObjectHolder, а не в куче
+    auto is_inline = [](const ObjectHolder& oh) {
+        const auto* begin = reinterpret_cast<const char*>(&oh);
+        const auto* object = reinterpret_cast<const char*>(oh.Get());
+        return object >= begin && object < begin + sizeof(oh);
+    };
+
+    auto num = ObjectHolder::Own(Number{42});
+    auto flag = ObjectHolder::Own(Bool{true});
+    auto str = ObjectHolder::Own(String{"text"s});
+    ASSERT(is_inline(num));
+    ASSERT(is_inline(flag));
+    ASSERT(!is_inline(str));
+
+    ASSERT(num.TryAs<Number>() != nullptr && num.TryAs<Number>()->GetValue() == 42);
+    ASSERT(num.TryAs<Bool>() == nullptr);
+    ASSERT(flag.TryAs<Bool>() != nullptr && flag.TryAs<Bool>()->GetValue());
+
+    ObjectHolder copy = num;
+    ASSERT(is_inline(copy));
+    ASSERT_EQUAL(copy.TryAs<Number>()->GetValue(), 42);
+
+    ObjectHolder moved = std::move(flag);
+    ASSERT(!flag);  // NOLINT
+    ASSERT(moved.TryAs<Bool>()->GetValue());
+
+    moved = copy;
+    ASSERT(moved.TryAs<Bool>() == nullptr);
+    ASSERT_EQUAL(moved.TryAs<Number>()->GetValue(), 42);
+
+    // Невладеющая ссылка на число указывает на исходный объект
+    Number external{7};
+    ASSERT(ObjectHolder::Share(external).Get() == &external);
+}
+
+void TestObjectTypes() {
+    ASSERT(ObjectHolder().GetType() == ObjectType::None);
+    ASSERT(ObjectHolder::Own(Number{1}).GetType() == ObjectType::Number);
+    ASSERT(ObjectHolder::Own(Bool{false}).GetType() == ObjectType::Bool);
+    ASSERT(ObjectHolder::Own(String{"s"s}).GetType() == ObjectType::String);
+
+    Class cls{"Test"s, {}, nullptr};
+    ASSERT(ObjectHolder::Share(cls).GetType() == ObjectType::Class);
+    auto instance = ObjectHolder::Own(ClassInstance{cls});
+    ASSERT(instance.GetType() == ObjectType::ClassInstance);
+    ASSERT(instance.TryAs<ClassInstance>() != nullptr);
+    ASSERT(instance.TryAs<Class>() == nullptr);
+
+    // Типы без собственного тега распознаются через dynamic_cast
+    auto logger = ObjectHolder::Own(Logger{});
+    ASSERT(logger.GetType() == ObjectType::Other);
+    ASSERT(logger.TryAs<Logger>() != nullptr);
+    ASSERT(logger.TryAs<Number>() == nullptr);
+}
+
+void TestRefCount() {
+    ASSERT_EQUAL(Logger::instance_count, 0);
+    {
+        auto one = ObjectHolder::Own(Logger(5));
+        ASSERT_EQUAL(one->GetRefCount(), 1U);
+        {
+            ObjectHolder two = one;
+            ASSERT(two.Get() == one.Get());
+            ASSERT_EQUAL(one->GetRefCount(), 2U);
+
+            // Заимствованная ссылка не владеет объектом, а её копия - владеет
+            auto borrowed = ObjectHolder::Share(*one);
+            ASSERT(borrowed.IsBorrowed());
+            ASSERT_EQUAL(one->GetRefCount(), 2U);
+            ObjectHolder borrowed_copy = borrowed;
+            ASSERT(!borrowed_copy.IsBorrowed());
+            ASSERT(borrowed_copy.Get() == one.Get());
+            ASSERT_EQUAL(one->GetRefCount(), 3U);
+        }
+        ASSERT_EQUAL(one->GetRefCount(), 1U);
+
+        // Копия объекта получает собственный счётчик ссылок
+        auto copy = ObjectHolder::Own(*one.TryAs<Logger>());
+        ASSERT_EQUAL(Logger::instance_count, 2);
+        ASSERT_EQUAL(copy->GetRefCount(), 1U);
+        ASSERT_EQUAL(one->GetRefCount(), 1U);
+
+        one = copy;
+        ASSERT_EQUAL(Logger::instance_count, 1);
+        ASSERT_EQUAL(copy->GetRefCount(), 2U);
+    }
+    ASSERT_EQUAL(Logger::instance_count, 0);
+
+    // Копии ссылки на объект, не созданный через Own, остаются заимствованными
+    Logger external;
+    auto shared = ObjectHolder::Share(external);
+    ObjectHolder shared_copy = shared;
+    ASSERT(shared_copy.IsBorrowed());
+    ASSERT_EQUAL(external.GetRefCount(), 0U);
+}
+
 void TestIsTrue() {
     {
         ASSERT(!IsTrue(ObjectHolder::Own(Bool{false})));
@@ -460,18 +589,293 @@ void TestComparison() {
         eq_closure.clear();
         lt_closure.clear();
 
-        // Greater / LessOrEqual
+        // Greater / LessOrEqual: операнды меняются местами, и вызывается только
+        // метод __lt__ правого операнда
         eq_result = ObjectHolder::Own(Bool{false});
-        lt_result = ObjectHolder::Own(Bool{false});
-        test_greater(ObjectHolder::Share(lhs), ObjectHolder::Share(rhs), true);
-        ASSERT(eq_closure.at("self"s).TryAs<ClassInstance>() == &lhs);
-        ASSERT(eq_closure.at("rhs"s).TryAs<ClassInstance>() == &rhs);
+        lt_result = ObjectHolder::Own(Bool{true});
+        test_greater(ObjectHolder::Share(rhs), ObjectHolder::Share(lhs), true);
         ASSERT(lt_closure.at("self"s).TryAs<ClassInstance>() == &lhs);
         ASSERT(lt_closure.at("rhs"s).TryAs<ClassInstance>() == &rhs);
-        eq_result = ObjectHolder::Own(Bool{true});
-        lt_result = ObjectHolder::Own(Bool{true});
-        test_greater(ObjectHolder::Share(lhs), ObjectHolder::Share(rhs), false);
+        ASSERT(eq_closure.empty());
+        lt_result = ObjectHolder::Own(Bool{false});
+        test_greater(ObjectHolder::Share(rhs), ObjectHolder::Share(lhs), false);
+        // Правый операнд без метода __lt__ не сравнивается
+        test_gt_uncomparable(ObjectHolder::Share(lhs), ObjectHolder::Share(rhs));
+    }
+}
+
+void TestComparisonCallCount() {
+    int lt_calls = 0;
+    int eq_calls = 0;
+    // Экземпляр меньше любого значения, не являющегося экземпляром
+    auto lt_body = [&lt_calls](Closure& closure, Context&) {
+        ++lt_calls;
+        const auto* self = closure.at("self"s).TryAs<ClassInstance>();
+        const auto* rhs = closure.at("rhs"s).TryAs<ClassInstance>();
+        return ObjectHolder::Own(Bool{rhs == nullptr || self < rhs});
+    };
+    auto eq_body = [&eq_calls](Closure&, Context&) {
+        ++eq_calls;
+        return ObjectHolder::Own(Bool{false});
+    };
+
+    vector<Method> methods;
+    methods.push_back({"__lt__"s, {"rhs"s}, make_unique<TestMethodBody>(lt_body)});
+    methods.push_back({"__eq__"s, {"rhs"s}, make_unique<TestMethodBody>(eq_body)});
+    Class cls{"Ordered"s, std::move(methods), nullptr};
+    ClassInstance first{cls};
+    ClassInstance second{cls};
+    auto lhs = ObjectHolder::Share(&first < &second ? first : second);
+    auto rhs = ObjectHolder::Share(&first < &second ? second : first);
+
+    // Каждый оператор порядка вызывает ровно один пользовательский метод
+    DummyContext ctx;
+    ASSERT(Less(lhs, rhs, ctx));
+    ASSERT(!Greater(lhs, rhs, ctx));
+    ASSERT(Greater(rhs, lhs, ctx));
+    ASSERT(LessOrEqual(lhs, rhs, ctx));
+    ASSERT(!GreaterOrEqual(lhs, rhs, ctx));
+    ASSERT_EQUAL(lt_calls, 5);
+    ASSERT_EQUAL(eq_calls, 0);
+
+    ASSERT(Compare(Comparator::Greater, rhs, lhs, ctx));
+    ASSERT(!Compare(Comparator::Equal, rhs, lhs, ctx));
+    ASSERT_EQUAL(lt_calls, 6);
+    ASSERT_EQUAL(eq_calls, 1);
+
+    // Значение и экземпляр: > и <= вызывают __lt__ у экземпляра справа, < и >= - слева
+    const ObjectHolder number = ObjectHolder::Own(Number{5});
+    ASSERT(Greater(number, lhs, ctx));
+    ASSERT(!LessOrEqual(number, lhs, ctx));
+    ASSERT(Less(lhs, number, ctx));
+    ASSERT(!GreaterOrEqual(lhs, number, ctx));
+    ASSERT_EQUAL(lt_calls, 10);
+    ASSERT_EQUAL(eq_calls, 1);
+
+    // Если у правого операнда > и <= нет метода __lt__, сравнение - ошибка без вызовов методов
+    Class unordered_cls{"Unordered"s, {}, nullptr};
+    ClassInstance unordered{unordered_cls};
+    const ObjectHolder unordered_holder = ObjectHolder::Share(unordered);
+    ASSERT_THROWS(Greater(lhs, number, ctx), std::runtime_error);
+    ASSERT_THROWS(LessOrEqual(lhs, number, ctx), std::runtime_error);
+    ASSERT_THROWS(Greater(lhs, unordered_holder, ctx), std::runtime_error);
+    ASSERT_THROWS(LessOrEqual(lhs, unordered_holder, ctx), std::runtime_error);
+    ASSERT_EQUAL(lt_calls, 10);
+    ASSERT_EQUAL(eq_calls, 1);
+}
+
+void TestArena() {
+    Arena arena(256);
+    auto* first = static_cast<char*>(arena.Allocate(10, 1));
+    auto* second = static_cast<char*>(arena.Allocate(16, 16));
+    ASSERT_EQUAL(reinterpret_cast<uintptr_t>(second) % 16, 0U);
+    ASSERT(second >= first + 10 && second < first + 26);
+    ASSERT_EQUAL(arena.GetBlockCount(), 1U);
+
+    // Объект, не помещающийся в блок, получает собственный блок,
+    // а следующие объекты размещаются в свободной части текущего блока
+    arena.Allocate(1000);
+    ASSERT_EQUAL(arena.GetBlockCount(), 2U);
+    auto* third = static_cast<char*>(arena.Allocate(8, 1));
+    ASSERT(third == second + 16);
+    ASSERT_EQUAL(arena.GetBlockCount(), 2U);
+    ASSERT_EQUAL(arena.GetAllocatedBytes(), 1034U);
+
+    // Executable размещается в текущей арене потока
+    const size_t allocated = arena.GetAllocatedBytes();
+    unique_ptr<Executable> in_arena;
+    {
+        ArenaScope scope(&arena);
+        ASSERT_EQUAL(Arena::GetCurrent(), &arena);
+        in_arena = make_unique<TestMethodBody>([](Closure&, Context&) { return ObjectHolder(); });
+    }
+    ASSERT(Arena::GetCurrent() == nullptr);
+    ASSERT(arena.GetAllocatedBytes() > allocated);
+
+    const size_t allocated_after = arena.GetAllocatedBytes();
+    auto on_heap = make_unique<TestMethodBody>([](Closure&, Context&) { return ObjectHolder(); });
+    ASSERT_EQUAL(arena.GetAllocatedBytes(), allocated_after);
+    in_arena.reset();
+    on_heap.reset();
+}
+
+void TestSymbols() {
+    const Symbol x{"x"s};
+    const size_t count = Symbol::GetCount();
+    ASSERT(Symbol("x"sv) == x);
+    ASSERT(Symbol("x") == x);
+    ASSERT(Symbol("test_symbols_new_name"s) != x);
+    ASSERT_EQUAL(Symbol::GetCount(), count + 1);
+    ASSERT_EQUAL(x.GetName(), "x"s);
+    ASSERT_EQUAL(Symbol().GetName(), ""s);
+    ASSERT(Symbol() == Symbol(""s));
+    ASSERT_EQUAL(Symbol().GetId(), 0U);
+    ASSERT_EQUAL(std::hash<Symbol>{}(x), size_t{x.GetId()});
+
+    // Потоки, интернирующие одни и те же имена, получают одни и те же символы
+    constexpr size_t THREAD_COUNT = 4;
+    vector<vector<Symbol>> thread_symbols(THREAD_COUNT);
+    vector<thread> threads;
+    for (size_t t = 0; t < THREAD_COUNT; ++t) {
+        threads.emplace_back([&symbols = thread_symbols[t]] {
+            for (size_t i = 0; i < 100; ++i) {
+                symbols.emplace_back("threaded_symbol_"s + to_string(i));
+            }
+        });
     }
+    for (thread& th : threads) {
+        th.join();
+    }
+    for (size_t t = 1; t < THREAD_COUNT; ++t) {
+        ASSERT(thread_symbols[t] == thread_symbols[0]);
+    }
+    ASSERT(Symbol("threaded_symbol_7"s) == thread_symbols[0][7]);
+
+    // Таблицы символов принимают имена в виде строк
+    Closure closure;
+    closure["x"s] = ObjectHolder::Own(Number{1});
+    ASSERT_EQUAL(closure.count(x), 1U);
+    ASSERT_EQUAL(closure.at("x"s).TryAs<Number>()->GetValue(), 1);
+    ASSERT_EQUAL("name: "s + x, "name: x"s);
+}
+
+void TestGarbageCollector() {
+    Class cls{"Node"s, {}, nullptr};
+    GarbageCollector gc(2, GarbageCollector::UNLIMITED);
+    GcScope scope(&gc);
+
+    // Создаёт два объекта, ссылающихся друг на друга
+    auto make_cycle = [&cls] {
+        auto first = ObjectHolder::Own(ClassInstance{cls});
+        auto second = ObjectHolder::Own(ClassInstance{cls});
+        first.TryAs<ClassInstance>()->Fields()["next"s] = second;
+        second.TryAs<ClassInstance>()->Fields()["next"s] = first;
+        return first;
+    };
+
+    ObjectHolder live = make_cycle();
+    ObjectHolder garbage = make_cycle();
+    garbage = ObjectHolder::None();
+    ASSERT_EQUAL(gc.GetTrackedCount(), 4U);
+
+    // Шаг рассматривает не более двух объектов, но за несколько шагов находит недостижимый цикл
+    size_t collected = 0;
+    for (int i = 0; i < 4; ++i) {
+        collected += gc.Step();
+    }
+    ASSERT_EQUAL(collected, 2U);
+    ASSERT_EQUAL(gc.GetTrackedCount(), 2U);
+    ASSERT_EQUAL(gc.GetStats().collections, 4U);
+    ASSERT_EQUAL(gc.GetStats().objects_collected, 2U);
+    ASSERT(gc.GetStats().bytes_collected >= 2 * sizeof(ClassInstance));
+
+    const ObjectHolder& next = live.TryAs<ClassInstance>()->Fields().at("next"s);
+    ASSERT(next.TryAs<ClassInstance>()->Fields().at("next"s).Get() == live.Get());
+
+    // Объект вне сборщика удерживает объекты, на которые ссылается
+    ClassInstance holder{cls};
+    holder.Fields()["node"s] = next;
+    live = ObjectHolder::None();
+    ASSERT_EQUAL(gc.Collect(), 0U);
+    holder.Fields().clear();
+    ASSERT_EQUAL(gc.Collect(), 2U);
+    ASSERT_EQUAL(gc.GetTrackedCount(), 1U);
+}
+
+void TestPools() {
+    // Освобождённый блок выдаётся повторно объекту того же класса размеров
+    {
+        auto first = ObjectHolder::Own(String("pooled"s));
+    }
+    const PoolStats objects_before = ObjectPool::GetStats();
+    {
+        auto second = ObjectHolder::Own(String("reused"s));
+        ASSERT_EQUAL(second.TryAs<String>()->GetValue(), "reused"s);
+    }
+    const PoolStats objects_after = ObjectPool::GetStats();
+    ASSERT_EQUAL(objects_after.hits, objects_before.hits + 1);
+    ASSERT_EQUAL(objects_after.misses, objects_before.misses);
+
+    // Блоки крупнее MAX_SIZE не проходят через пул
+    void* large = ObjectPool::Allocate(ObjectPool::MAX_SIZE + 1);
+    ObjectPool::Deallocate(large, ObjectPool::MAX_SIZE + 1);
+    ASSERT_EQUAL(ObjectPool::GetStats().hits, objects_after.hits);
+
+    // Кадр возвращается в пул и выдаётся повторно с пустыми слотами
+    {
+        PooledFrame frame(3);
+        (*frame)[1] = ObjectHolder::Own(Number(1));
+    }
+    const PoolStats frames_before = FramePool::GetStats();
+    {
+        PooledFrame frame(3);
+        ASSERT_EQUAL(frame->size(), 3U);
+        for (const auto& slot : *frame) {
+            ASSERT(!slot.has_value());
+        }
+    }
+    const PoolStats frames_after = FramePool::GetStats();
+    ASSERT_EQUAL(frames_after.hits, frames_before.hits + 1);
+    ASSERT_EQUAL(frames_after.misses, frames_before.misses);
+}
+
+void TestMemoryAccount() {
+    const string text(100, 'x');
+    MemoryAccount account(2048);
+    {
+        MemoryScope scope(&account);
+        auto str = ObjectHolder::Own(String(text));
+        const size_t used = account.GetStats().current;
+        ASSERT(used >= sizeof(String) + text.size());
+
+        // Превышение лимита не изменяет счёт
+        ASSERT_THROWS(static_cast<void>(ObjectHolder::Own(String(string(4096, 'y')))), MemoryLimitError);
+        ASSERT_EQUAL(account.GetStats().current, used);
+
+        // Длинная строка, построенная конкатенацией, учитывается вместе с частями
+        String rope = String::Concat(String(text), String(text));
+        ASSERT(account.GetStats().current >= used + 2 * text.size());
+        account.SetLimit(account.GetStats().current + 16);
+        ASSERT_THROWS(static_cast<void>(rope.GetValue()), MemoryLimitError);
+        ASSERT(!rope.IsFlat());
+        account.SetLimit(MemoryAccount::UNLIMITED);
+        ASSERT_EQUAL(rope.GetValue(), text + text);
+    }
+    ASSERT_EQUAL(account.GetStats().current, 0U);
+    ASSERT(account.GetStats().peak > 0);
+    ASSERT(account.GetStats().total_allocated >= account.GetStats().peak);
+
+    // Память возвращается в счёт, в котором была учтена, а не в счёт, текущий при освобождении
+    {
+        MemoryAccount owner;
+        MemoryAccount other;
+        ObjectHolder str;
+        String value{""s};
+        {
+            MemoryScope scope(&owner);
+            str = ObjectHolder::Own(String(text));
+            value = String(text);
+        }
+        ASSERT(owner.GetStats().current > 0);
+        {
+            MemoryScope scope(&other);
+            str = ObjectHolder::Own(Number(1));
+            value = String(""s);
+            ASSERT_EQUAL(other.GetStats().current, 0U);
+        }
+        ASSERT_EQUAL(owner.GetStats().current, 0U);
+        ASSERT_EQUAL(other.GetStats().total_allocated, 0U);
+    }
+
+    // Поля экземпляров класса учитываются при добавлении
+    Class cls{"Point"s, {}, nullptr};
+    MemoryAccount fields_account;
+    MemoryScope scope(&fields_account);
+    auto point = ObjectHolder::Own(ClassInstance(cls));
+    const size_t empty_size = fields_account.GetStats().current;
+    FieldCache cache;
+    point.TryAs<ClassInstance>()->SetField("x"s, ObjectHolder::Own(Number(1)), cache);
+    ASSERT(fields_account.GetStats().current >= empty_size + sizeof(ObjectHolder));
 }
 
 void TestClass() {
@@ -504,6 +908,146 @@ void TestClass() {
     ASSERT_EQUAL(out.str(), "Class Test"s);
 }
 
+void TestMethodCache() {
+    vector<Method> base_methods;
+    base_methods.push_back({"f"s, {}, make_unique<TestMethodBody>(
+                                          [](Closure&, Context&) { return ObjectHolder::None(); })});
+    base_methods.push_back({"g"s, {}, make_unique<TestMethodBody>(
+                                          [](Closure&, Context&) { return ObjectHolder::None(); })});
+    Class base{"Base"s, std::move(base_methods), nullptr};
+
+    vector<Method> child_methods;
+    child_methods.push_back({"f"s, {"x"s}, make_unique<TestMethodBody>(
+                                              [](Closure&, Context&) { return ObjectHolder::None(); })});
+    Class child{"Child"s, std::move(child_methods), &base};
+    Class grandchild{"Grandchild"s, {}, &child};
+
+    MethodCache cache;
+    ASSERT_EQUAL(cache.Lookup(grandchild, InternMethodName("f"s)), child.GetMethod("f"s));
+    ASSERT_EQUAL(cache.Lookup(base, InternMethodName("f"s)), base.GetMethod("f"s));
+    ASSERT_EQUAL(cache.GetSize(), 2U);
+
+    // Повторный поиск не добавляет записей и возвращает тот же метод
+    ASSERT_EQUAL(cache.Lookup(grandchild, InternMethodName("f"s)), child.GetMethod("f"s));
+    ASSERT_EQUAL(cache.GetSize(), 2U);
+
+    MethodCache missing_cache;
+    ASSERT(missing_cache.Lookup(child, InternMethodName("h"s)) == nullptr);
+    ASSERT(missing_cache.Lookup(child, InternMethodName("h"s)) == nullptr);
+    ASSERT_EQUAL(missing_cache.GetSize(), 1U);
+
+    // Классы сверх ёмкости кэша обрабатываются без кэширования
+    vector<unique_ptr<Class>> classes;
+    MethodCache megamorphic_cache;
+    const MethodId g_id = InternMethodName("g"s);
+    for (size_t i = 0; i < MethodCache::CAPACITY + 2; ++i) {
+        classes.push_back(make_unique<Class>("C"s + to_string(i), vector<Method>{}, &base));
+        ASSERT_EQUAL(megamorphic_cache.Lookup(*classes.back(), g_id), base.GetMethod("g"s));
+    }
+    ASSERT_EQUAL(megamorphic_cache.GetSize(), MethodCache::CAPACITY);
+}
+
+void TestMethodTable() {
+    auto make_body = [] {
+        return make_unique<TestMethodBody>([](Closure&, Context&) { return ObjectHolder::None(); });
+    };
+
+    vector<Method> base_methods;
+    base_methods.push_back({"__str__"s, {}, make_body()});
+    base_methods.push_back({"__eq__"s, {"rhs"s}, make_body()});
+    base_methods.push_back({"area"s, {}, make_body()});
+    Class base{"Base"s, std::move(base_methods), nullptr};
+
+    vector<Method> child_methods;
+    child_methods.push_back({"__str__"s, {}, make_body()});
+    child_methods.push_back({"__init__"s, {"x"s}, make_body()});
+    Class child{"Child"s, std::move(child_methods), &base};
+    Class grandchild{"Grandchild"s, {}, &child};
+
+    // Таблица методов наследника содержит унаследованные и замещённые методы
+    const MethodId area_id = InternMethodName("area"s);
+    const MethodId str_id = InternMethodName("__str__"s);
+    ASSERT_EQUAL(grandchild.GetMethod(area_id), base.GetMethod(area_id));
+    ASSERT_EQUAL(grandchild.GetMethod(str_id), child.GetMethod(str_id));
+    ASSERT(base.GetMethod(str_id) != child.GetMethod(str_id));
+    ASSERT_EQUAL(grandchild.GetMethod("area"s), base.GetMethod(area_id));
+    ASSERT(grandchild.GetMethod(InternMethodName("unknown"s)) == nullptr);
+    ASSERT(grandchild.GetMethod("never_interned_name"s) == nullptr);
+
+    // Слоты специальных методов заполнены с учётом наследования
+    ASSERT_EQUAL(grandchild.GetSpecialMethod(SpecialMethod::Str), child.GetMethod(str_id));
+    ASSERT_EQUAL(grandchild.GetSpecialMethod(SpecialMethod::Eq), base.GetMethod("__eq__"s));
+    ASSERT_EQUAL(grandchild.GetSpecialMethod(SpecialMethod::Init), child.GetMethod("__init__"s));
+    ASSERT(grandchild.GetSpecialMethod(SpecialMethod::Lt) == nullptr);
+    ASSERT(base.GetSpecialMethod(SpecialMethod::Init) == nullptr);
+
+    ClassInstance instance{grandchild};
+    ASSERT(instance.GetSpecialMethod(SpecialMethod::Init, 1) != nullptr);
+    ASSERT(instance.GetSpecialMethod(SpecialMethod::Init, 0) == nullptr);
+
+    // Имена, зарегистрированные одновременно из нескольких потоков, получают общие идентификаторы
+    constexpr size_t THREAD_COUNT = 4;
+    constexpr size_t NAME_COUNT = 200;
+    vector<vector<MethodId>> ids(THREAD_COUNT);
+    vector<thread> threads;
+    for (size_t t = 0; t < THREAD_COUNT; ++t) {
+        threads.emplace_back([&ids, t] {
+            for (size_t i = 0; i < NAME_COUNT; ++i) {
+                ids[t].push_back(InternMethodName("threaded_method_"s + to_string(i)));
+            }
+        });
+    }
+    for (thread& th : threads) {
+        th.join();
+    }
+    for (size_t t = 1; t < THREAD_COUNT; ++t) {
+        ASSERT_EQUAL(ids[t], ids[0]);
+    }
+}
+
+void TestInstanceShapes() {
+    Class cls{"Point"s, {}, nullptr};
+    ClassInstance a{cls};
+    ClassInstance b{cls};
+
+    // Экземпляры, получившие поля в одном порядке, разделяют форму
+    FieldCache set_x;
+    FieldCache set_y;
+    a.SetField("x"s, ObjectHolder::Own(Number{1}), set_x);
+    a.SetField("y"s, ObjectHolder::Own(Number{2}), set_y);
+    const Shape* xy_shape = set_y.next_shape;
+    ASSERT(xy_shape != nullptr);
+    ASSERT_EQUAL(xy_shape->GetFieldNames(), (vector<Symbol>{"x"s, "y"s}));
+
+    b.SetField("x"s, ObjectHolder::Own(Number{3}), set_x);
+    b.SetField("y"s, ObjectHolder::Own(Number{4}), set_y);
+    ASSERT_EQUAL(set_y.next_shape, xy_shape);
+
+    // Доступ к полю кэширует смещение для формы объекта
+    FieldCache get_y;
+    ASSERT_EQUAL(a.FindField("y"s, get_y)->TryAs<Number>()->GetValue(), 2);
+    ASSERT_EQUAL(get_y.shape, xy_shape);
+    ASSERT_EQUAL(get_y.offset, 1U);
+    ASSERT_EQUAL(b.FindField("y"s, get_y)->TryAs<Number>()->GetValue(), 4);
+    FieldCache get_missing;
+    ASSERT(b.FindField("z"s, get_missing) == nullptr);
+
+    // Перезапись существующего поля не меняет форму
+    FieldCache set_x_again;
+    b.SetField("x"s, ObjectHolder::Own(Number{5}), set_x_again);
+    ASSERT(set_x_again.next_shape == nullptr);
+    ASSERT_EQUAL(b.FindField("y"s, get_y)->TryAs<Number>()->GetValue(), 4);
+
+    // Обращение к Fields переводит объект в режим словаря без потери значений
+    ASSERT_EQUAL(b.Fields().size(), 2U);
+    ASSERT_EQUAL(b.Fields().at("x"s).TryAs<Number>()->GetValue(), 5);
+    b.Fields()["z"s] = ObjectHolder::Own(Number{6});
+    FieldCache get_z;
+    ASSERT_EQUAL(b.FindField("z"s, get_z)->TryAs<Number>()->GetValue(), 6);
+    b.SetField("y"s, ObjectHolder::Own(Number{7}), set_y);
+    ASSERT_EQUAL(b.Fields().at("y"s).TryAs<Number>()->GetValue(), 7);
+}
+
 void TestClassInstance() {
     vector<Method> methods;
 
@@ -534,12 +1078,22 @@ void TestClassInstance() {
 void RunObjectsTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestNumber);
     RUN_TEST(tr, runtime::TestString);
+    RUN_TEST(tr, runtime::TestStringConcat);
     RUN_TEST(tr, runtime::TestBool);
     RUN_TEST(tr, runtime::TestMethodInvocation);
     RUN_TEST(tr, runtime::TestIsTrue);
     RUN_TEST(tr, runtime::TestComparison);
+    RUN_TEST(tr, runtime::TestComparisonCallCount);
+    RUN_TEST(tr, runtime::TestArena);
+    RUN_TEST(tr, runtime::TestSymbols);
+    RUN_TEST(tr, runtime::TestGarbageCollector);
+    RUN_TEST(tr, runtime::TestPools);
+    RUN_TEST(tr, runtime::TestMemoryAccount);
     RUN_TEST(tr, runtime::TestClass);
     RUN_TEST(tr, runtime::TestClassInstance);
+    RUN_TEST(tr, runtime::TestMethodCache);
+    RUN_TEST(tr, runtime::TestMethodTable);
+    RUN_TEST(tr, runtime::TestInstanceShapes);
 }
 
 void RunObjectHolderTests(TestRunner& tr) {
@@ -547,6 +1101,9 @@ void RunObjectHolderTests(TestRunner& tr) {
     RUN_TEST(tr, runtime::TestOwning);
     RUN_TEST(tr, runtime::TestMove);
     RUN_TEST(tr, runtime::TestNullptr);
+    RUN_TEST(tr, runtime::TestInlineValues);
+    RUN_TEST(tr, runtime::TestObjectTypes);
+    RUN_TEST(tr, runtime::TestRefCount);
 }
 
 }  // namespace runtime
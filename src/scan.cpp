@@ -0,0 +1,191 @@
+#include "scan.h"
+
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace parse::scan {
+
+namespace {
+
+/*
+ * Операции над блоками символов. Перегружены для векторов SSE2 (16 байт) и AVX2 (32 байта),
+ * чтобы условия поиска записывались одним шаблоном для обоих размеров блока
+ */
+#if defined(__SSE2__)
+__m128i Load(const char* pos, __m128i) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+}
+
+unsigned Mask(__m128i x) {
+    return static_cast<unsigned>(_mm_movemask_epi8(x));
+}
+
+__m128i Equal(__m128i x, char ch) {
+    return _mm_cmpeq_epi8(x, _mm_set1_epi8(ch));
+}
+
+// Возвращает маску байтов x, лежащих в диапазоне [lo, hi]. Диапазон не должен содержать
+// байтов больше 127: при знаковом сравнении они меньше любого символа ASCII
+__m128i InRange(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(hi + 1)), x));
+}
+
+__m128i Or(__m128i lhs, __m128i rhs) {
+    return _mm_or_si128(lhs, rhs);
+}
+
+// Устанавливает бит 0x20 каждого байта, переводя заглавные латинские буквы в строчные
+__m128i ToLower(__m128i x) {
+    return _mm_or_si128(x, _mm_set1_epi8(0x20));
+}
+#endif
+
+#if defined(__AVX2__)
+__m256i Load(const char* pos, __m256i) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+}
+
+unsigned Mask(__m256i x) {
+    return static_cast<unsigned>(_mm256_movemask_epi8(x));
+}
+
+__m256i Equal(__m256i x, char ch) {
+    return _mm256_cmpeq_epi8(x, _mm256_set1_epi8(ch));
+}
+
+__m256i InRange(__m256i x, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), x));
+}
+
+__m256i Or(__m256i lhs, __m256i rhs) {
+    return _mm256_or_si256(lhs, rhs);
+}
+
+__m256i ToLower(__m256i x) {
+    return _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+}
+#endif
+
+/*
+ * Условия поиска. Для символа возвращают true, если символ подходит, для блока -
+ * маску подходящих символов. Функция Find ищет первый символ, для которого значение
+ * условия равно значению параметра шаблона Expected
+ */
+struct Space {
+    bool operator()(char ch) const {
+        return Is(ch, SPACE);
+    }
+    template <typename Block>
+    Block operator()(Block block) const {
+        return Equal(block, ' ');
+    }
+};
+
+struct IdChar {
+    bool operator()(char ch) const {
+        return Is(ch, ID);
+    }
+    template <typename Block>
+    Block operator()(Block block) const {
+        return Or(Or(InRange(ToLower(block), 'a', 'z'), InRange(block, '0', '9')),
+                  Equal(block, '_'));
+    }
+};
+
+struct StringStop {
+    char quote;
+
+    bool operator()(char ch) const {
+        return ch == quote || ch == '\\' || ch == '\n' || ch == '\r';
+    }
+    template <typename Block>
+    Block operator()(Block block) const {
+        return Or(Or(Equal(block, quote), Equal(block, '\\')),
+                  Or(Equal(block, '\n'), Equal(block, '\r')));
+    }
+};
+
+struct LineEnd {
+    bool operator()(char ch) const {
+        return ch == '\n';
+    }
+    template <typename Block>
+    Block operator()(Block block) const {
+        return Equal(block, '\n');
+    }
+};
+
+#if defined(__SSE2__)
+// Просматривает блоки вида Block размером sizeof(Block) байт, пока в [pos, end)
+// остаётся целый блок. Возвращает позицию найденного символа либо начало непросмотренного хвоста
+template <typename Block, bool Expected, typename Predicate>
+const char* FindInBlocks(const char* pos, const char* end, Predicate predicate, bool& found) {
+    constexpr unsigned all = sizeof(Block) == 32 ? ~0U : (1U << sizeof(Block)) - 1;
+    for (; end - pos >= static_cast<std::ptrdiff_t>(sizeof(Block)); pos += sizeof(Block)) {
+        unsigned mask = Mask(predicate(Load(pos, Block{})));
+        if constexpr (!Expected) {
+            mask ^= all;
+        }
+        if (mask != 0) {
+            found = true;
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return pos;
+}
+#endif
+
+template <bool Expected, typename Predicate>
+const char* Find(const char* pos, const char* end, Predicate predicate) {
+    // Большинство лексем короткие, поэтому первый символ проверяется до перехода к блокам
+    if (pos == end || predicate(*pos) == Expected) {
+        return pos;
+    }
+    ++pos;
+
+    [[maybe_unused]] bool found = false;
+#if defined(__AVX2__)
+    pos = FindInBlocks<__m256i, Expected>(pos, end, predicate, found);
+    if (found) {
+        return pos;
+    }
+#endif
+#if defined(__SSE2__)
+    pos = FindInBlocks<__m128i, Expected>(pos, end, predicate, found);
+    if (found) {
+        return pos;
+    }
+#endif
+    while (pos != end && predicate(*pos) != Expected) {
+        ++pos;
+    }
+    return pos;
+}
+
+}  // namespace
+
+const char* SkipSpaces(const char* pos, const char* end) {
+    return Find<false>(pos, end, Space{});
+}
+
+const char* SkipIdChars(const char* pos, const char* end) {
+    return Find<false>(pos, end, IdChar{});
+}
+
+const char* FindStringStop(const char* pos, const char* end, char quote) {
+    return Find<true>(pos, end, StringStop{quote});
+}
+
+const char* FindLineEnd(const char* pos, const char* end) {
+    return Find<true>(pos, end, LineEnd{});
+}
+
+}  // namespace parse::scan
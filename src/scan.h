@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace parse::scan {
+
+// Классы символов исходного текста. Символ может принадлежать нескольким классам
+enum CharClass : std::uint8_t {
+    SPACE = 1,     // Пробел
+    DIGIT = 2,     // Десятичная цифра
+    ID_START = 4,  // Первый символ идентификатора: латинская буква либо '_'
+    ID = 8,        // Символ идентификатора: латинская буква, цифра либо '_'
+};
+
+namespace detail {
+constexpr std::array<std::uint8_t, 256> MakeCharClasses() {
+    std::array<std::uint8_t, 256> classes{};
+    classes[static_cast<unsigned char>(' ')] |= SPACE;
+    for (int ch = '0'; ch <= '9'; ++ch) {
+        classes[ch] |= DIGIT | ID;
+    }
+    for (int ch = 'a'; ch <= 'z'; ++ch) {
+        classes[ch] |= ID_START | ID;
+        classes[ch - 'a' + 'A'] |= ID_START | ID;
+    }
+    classes[static_cast<unsigned char>('_')] |= ID_START | ID;
+    return classes;
+}
+}  // namespace detail
+
+// Таблица классов символов, построенная при компиляции
+inline constexpr std::array<std::uint8_t, 256> CHAR_CLASSES = detail::MakeCharClasses();
+
+// Возвращает true, если символ ch принадлежит хотя бы одному из классов classes
+constexpr bool Is(char ch, std::uint8_t classes) {
+    return (CHAR_CLASSES[static_cast<unsigned char>(ch)] & classes) != 0;
+}
+
+/*
+ * Функции поиска в тексте [pos, end). Текст просматривается блоками по 32 (AVX2) либо
+ * 16 (SSE2) байт, если эти наборы инструкций доступны при компиляции, иначе побайтово.
+ * Функции не читают память за пределами end и возвращают end, если символ не найден
+ */
+
+// Возвращает позицию первого символа, не являющегося пробелом
+const char* SkipSpaces(const char* pos, const char* end);
+// Возвращает позицию первого символа, который не может входить в идентификатор
+const char* SkipIdChars(const char* pos, const char* end);
+// Возвращает позицию первого символа, прерывающего строковую константу:
+// закрывающей кавычки quote, '\\', '\n' либо '\r'
+const char* FindStringStop(const char* pos, const char* end, char quote);
+// Возвращает позицию первого перевода строки
+const char* FindLineEnd(const char* pos, const char* end);
+
+}  // namespace parse::scan
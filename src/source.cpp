@@ -0,0 +1,105 @@
+#include "source.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PARSE_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+namespace parse {
+
+Source Source::FromString(string text) {
+    Source source;
+    source.owned_ = std::move(text);
+    source.text_ = source.owned_;
+    return source;
+}
+
+Source Source::FromStream(istream& input) {
+    ostringstream text;
+    // Пустой поток выставляет failbit у text, но это не ошибка
+    text << input.rdbuf();
+    return FromString(std::move(text).str());
+}
+
+Source Source::MapFile(const string& path) {
+#ifdef PARSE_HAS_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Cannot open file "s + path);
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw runtime_error("Cannot read file "s + path);
+    }
+
+    Source source;
+    const auto size = static_cast<size_t>(file_stat.st_size);
+    // Пустой файл отобразить нельзя, его текст остаётся пустым
+    if (size > 0) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Cannot map file "s + path);
+        }
+        // Файл читается последовательно от начала до конца
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        source.mapping_ = mapping;
+        source.mapping_size_ = size;
+        source.text_ = string_view(static_cast<const char*>(mapping), size);
+    }
+    close(fd);
+    return source;
+#else
+    ifstream input(path, ios::binary);
+    if (!input) {
+        throw runtime_error("Cannot open file "s + path);
+    }
+    return FromStream(input);
+#endif
+}
+
+Source::Source(Source&& other) noexcept {
+    *this = std::move(other);
+}
+
+Source& Source::operator=(Source&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        mapping_ = exchange(other.mapping_, nullptr);
+        mapping_size_ = exchange(other.mapping_size_, 0);
+        owned_ = std::move(other.owned_);
+        // Короткие строки при перемещении копируются, поэтому text_ указывает на новый буфер
+        text_ = mapping_ != nullptr ? other.text_ : string_view(owned_);
+        other.owned_.clear();
+        other.text_ = {};
+    }
+    return *this;
+}
+
+Source::~Source() {
+    Unmap();
+}
+
+void Source::Unmap() noexcept {
+#ifdef PARSE_HAS_MMAP
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+}
+
+}  // namespace parse
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace parse {
+
+/*
+ * Исходный текст программы, размещённый в памяти одним непрерывным блоком.
+ * Текст либо принадлежит объекту, либо отображён в память из файла
+ */
+class Source {
+public:
+    // Создаёт источник с пустым текстом
+    Source() = default;
+
+    // Создаёт источник, владеющий текстом text
+    [[nodiscard]] static Source FromString(std::string text);
+    // Считывает поток input до конца
+    [[nodiscard]] static Source FromStream(std::istream& input);
+    // Отображает в память файл path. Если файл не удаётся открыть, выбрасывает runtime_error
+    [[nodiscard]] static Source MapFile(const std::string& path);
+
+    Source(Source&& other) noexcept;
+    Source& operator=(Source&& other) noexcept;
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+
+    ~Source();
+
+    [[nodiscard]] std::string_view GetText() const {
+        return text_;
+    }
+
+private:
+    // Освобождает отображённую в память область
+    void Unmap() noexcept;
+
+    std::string owned_;          // Текст, принадлежащий источнику
+    std::string_view text_;      // Текст источника: owned_ либо отображённый файл
+    void* mapping_ = nullptr;    // Начало отображённой в память области
+    std::size_t mapping_size_ = 0;
+};
+
+}  // namespace parse
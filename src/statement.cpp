@@ -1,7 +1,8 @@
 #include "statement.h"
 
+#include "gc.h"
+
 #include <iostream>
-#include <sstream>
 
 using namespace std;
 
@@ -12,48 +13,118 @@ using runtime::Context;
 using runtime::ObjectHolder;
 
 namespace {
-const string ADD_METHOD = "__add__"s;
-const string INIT_METHOD = "__init__"s;
+// Возвращает значение слота slot кадра выполняемого метода.
+// Если переменной ещё не присвоено значение - выбрасывает исключение
+const ObjectHolder& GetSlotValue(Context& context, size_t slot, runtime::Symbol name) {
+    const optional<ObjectHolder>& value = context.GetFrame()->at(slot);
+    if (!value) {
+        throw runtime_error("Wrong var name: "s + name);
+    }
+    return *value;
+}
+
+// Возвращает функцию, вызывающую метод объекта без аргументов, для операций среды исполнения
+auto CallWithoutArguments(Context& context) {
+    return [&context](runtime::ClassInstance& instance, const runtime::Method& method) {
+        return instance.Call(method, {}, context);
+    };
+}
+
+// Вычисляет аргументы args и вызывает метод method объекта instance.
+// Аргументы метода, использующего кадр, вычисляются сразу в слоты кадра из пула
+ObjectHolder CallMethod(runtime::ClassInstance& instance, const runtime::Method& method,
+                        const vector<unique_ptr<Statement>>& args, Closure& closure,
+                        Context& context) {
+    method.Prepare();
+    if (method.frame_size > 0) {
+        runtime::PooledFrame frame(method.frame_size);
+        for (size_t i = 0; i < args.size(); ++i) {
+            (*frame)[i + 1] = args[i]->Execute(closure, context);
+        }
+        return instance.CallWithFrame(method, *frame, context);
+    }
+
+    vector<ObjectHolder> actual_args;
+    actual_args.reserve(args.size());
+    for (const unique_ptr<Statement>& arg : args) {
+        actual_args.push_back(arg->Execute(closure, context));
+    }
+    return instance.Call(method, actual_args, context);
+}
 }  // namespace
 
 ObjectHolder Assignment::Execute(Closure& closure, Context& context) {
-    closure[var_] = rv_->Execute(closure, context);
-    return closure.at(var_);
+    ObjectHolder value = rv_->Execute(closure, context);
+    if (slot_) {
+        return *(context.GetFrame()->at(*slot_) = std::move(value));
+    }
+    return closure[var_] = std::move(value);
 }
 
-Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
-    : var_(std::move(var))
+Assignment::Assignment(runtime::Symbol var, std::unique_ptr<Statement> rv)
+    : var_(var)
+    , rv_(std::move(rv))
+{ /* do nothing */ }
+
+Assignment::Assignment(runtime::Symbol var, std::unique_ptr<Statement> rv, size_t slot)
+    : var_(var)
     , rv_(std::move(rv))
+    , slot_(slot)
 { /* do nothing */ }
 
-VariableValue::VariableValue(const std::string& var_name)
-    : dotted_ids_(1, std::move(var_name))
+VariableValue::VariableValue(runtime::Symbol var_name)
+    : dotted_ids_(1, var_name)
+    , field_caches_(dotted_ids_.size())
+{ /* do nothing */ }
+
+VariableValue::VariableValue(const std::vector<std::string>& dotted_ids)
+    : dotted_ids_(dotted_ids.begin(), dotted_ids.end())
+    , field_caches_(dotted_ids_.size())
+{ /* do nothing */ }
+
+VariableValue::VariableValue(std::vector<runtime::Symbol> dotted_ids)
+    : dotted_ids_(std::move(dotted_ids))
+    , field_caches_(dotted_ids_.size())
 { /* do nothing */ }
 
-VariableValue::VariableValue(std::vector<std::string> dotted_ids)
+VariableValue::VariableValue(std::vector<runtime::Symbol> dotted_ids, size_t slot)
     : dotted_ids_(std::move(dotted_ids))
+    , slot_(slot)
+    , field_caches_(dotted_ids_.size())
 { /* do nothing */ }
 
-ObjectHolder VariableValue::Execute(Closure& closure, Context& /*context*/) {
-    // Заводим указатель на таблицу символов, будем обновлять при необходимости
-    Closure* closure_ptr = &closure;
-    ObjectHolder result;
-
-    // Итерируемся по цепочке, присваиваем result очередной объект.
-    // Если объект является классом - обновляем указатель на таблицу символов.
-    // Если в таблице такой переменной нет - выбрасываем исключение
-    for (const std::string& id : dotted_ids_) {
-        if (closure_ptr->find(id) == closure_ptr->end()) {
-            throw runtime_error("Wrong var name: "s + id);
+ObjectHolder VariableValue::Execute(Closure& closure, Context& context) {
+    // Промежуточные значения цепочки не копируются: счётчик ссылок изменяется
+    // только при копировании итогового значения
+    const ObjectHolder* result = nullptr;
+
+    // Первый идентификатор цепочки - переменная метода либо глобальная переменная
+    if (slot_) {
+        result = &GetSlotValue(context, *slot_, dotted_ids_.front());
+    }
+    else {
+        auto it = closure.find(dotted_ids_.front());
+        if (it == closure.end()) {
+            throw runtime_error("Wrong var name: "s + dotted_ids_.front());
+        }
+        result = &it->second;
+    }
+
+    // Остальные идентификаторы - поля объектов.
+    // Если очередного поля нет - выбрасываем исключение
+    for (size_t i = 1; i < dotted_ids_.size(); ++i) {
+        if (result->GetType() != runtime::ObjectType::ClassInstance) {
+            throw runtime_error("Wrong var name: "s + dotted_ids_[i]);
         }
 
-        result = closure_ptr->at(id);
-        if (result.TryAs<runtime::ClassInstance>()) {
-            closure_ptr = &result.TryAs<runtime::ClassInstance>()->Fields();
+        auto* instance = static_cast<runtime::ClassInstance*>(result->Get());
+        result = instance->FindField(dotted_ids_[i], field_caches_[i]);
+        if (result == nullptr) {
+            throw runtime_error("Wrong var name: "s + dotted_ids_[i]);
         }
     }
 
-    return result;
+    return *result;
 }
 
 unique_ptr<Print> Print::Variable(const std::string& name) {
@@ -80,134 +151,85 @@ ObjectHolder Print::Execute(Closure& closure, Context& context) {
         }
         first = false;
 
-        if (var) {
-            var->Print(output, context);
-        }
-        else {
-            output << "None"s;
-        }
+        runtime::PrintValue(var, output, context, CallWithoutArguments(context));
     }
 
     output << '\n';
     return {};
 }
 
-MethodCall::MethodCall(std::unique_ptr<Statement> object, std::string method,
+MethodCall::MethodCall(std::unique_ptr<Statement> object, runtime::Symbol method,
                        std::vector<std::unique_ptr<Statement>> args)
-    : method_(std::move(method))
+    : method_(method)
+    , method_id_(runtime::InternMethodName(method_))
     , object_(std::move(object))
     , args_(std::move(args))
 { /* do nothing */ }
 
 ObjectHolder MethodCall::Execute(Closure& closure, Context& context) {
-    auto class_ptr = object_->Execute(closure, context).TryAs<runtime::ClassInstance>();
-
-    if (!class_ptr || !class_ptr->HasMethod(method_, args_.size())) {
+    ObjectHolder object = object_->Execute(closure, context);
+    if (object.GetType() != runtime::ObjectType::ClassInstance) {
         return {};
     }
 
-    vector<ObjectHolder> actual_args;
-    for (const unique_ptr<Statement>& arg_ptr : args_) {
-        actual_args.push_back(arg_ptr->Execute(closure, context));
+    auto* instance = static_cast<runtime::ClassInstance*>(object.Get());
+    const runtime::Method* method = cache_.Lookup(instance->GetClass(), method_id_);
+    if (method == nullptr || method->formal_params.size() != args_.size()) {
+        return {};
     }
 
-    return class_ptr->Call(method_, actual_args, context);
+    return CallMethod(*instance, *method, args_, closure, context);
 }
 
 ObjectHolder Stringify::Execute(Closure& closure, Context& context) {
     ObjectHolder var = argument_->Execute(closure, context);
-
-    if (!var) {
-        return ObjectHolder::Own(runtime::String("None"s));
-    }
-
-    stringstream ss;
-    var->Print(ss, context);
-    return ObjectHolder::Own(runtime::String(ss.str()));
+    return runtime::Stringify(var, context, CallWithoutArguments(context));
 }
 
 ObjectHolder Add::Execute(Closure& closure, Context& context) {
     ObjectHolder lhs_obj = lhs_->Execute(closure, context);
     ObjectHolder rhs_obj = rhs_->Execute(closure, context);
 
-    if (!(lhs_obj && rhs_obj)) {
-        throw runtime_error("Attemp to Add wrong object types"s);
-    }
-
-    if (lhs_obj.TryAs<runtime::Number>() && rhs_obj.TryAs<runtime::Number>()) {
-        return ObjectHolder::Own(runtime::Number(lhs_obj.TryAs<runtime::Number>()->GetValue()
-                                 + rhs_obj.TryAs<runtime::Number>()->GetValue()));
-    }
-    if (lhs_obj.TryAs<runtime::String>() && rhs_obj.TryAs<runtime::String>()) {
-        return ObjectHolder::Own(runtime::String(lhs_obj.TryAs<runtime::String>()->GetValue()
-                                 + rhs_obj.TryAs<runtime::String>()->GetValue()));
-    }
-    if (lhs_obj.TryAs<runtime::ClassInstance>()
-            && lhs_obj.TryAs<runtime::ClassInstance>()->HasMethod(ADD_METHOD, 1)) {
-        return lhs_obj.TryAs<runtime::ClassInstance>()->Call(ADD_METHOD, { rhs_obj }, context);
-    }
-
-    throw runtime_error("Attemp to Add wrong object types"s);
+    return runtime::Add(lhs_obj, rhs_obj,
+                        [&](runtime::ClassInstance& instance, const runtime::Method& method) {
+                            return instance.Call(method, { rhs_obj }, context);
+                        });
 }
 
 ObjectHolder Sub::Execute(Closure& closure, Context& context) {
     ObjectHolder lhs_obj = lhs_->Execute(closure, context);
     ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-    if (!(lhs_obj && rhs_obj)) {
-        throw runtime_error("Attemp to Substract wrong object types"s);
-    }
-
-    if (lhs_obj.TryAs<runtime::Number>() && rhs_obj.TryAs<runtime::Number>()) {
-        return ObjectHolder::Own(runtime::Number(lhs_obj.TryAs<runtime::Number>()->GetValue()
-                                 - rhs_obj.TryAs<runtime::Number>()->GetValue()));
-    }
-
-    throw runtime_error("Attemp to Substract wrong object types"s);
+    return runtime::Arithmetic(runtime::ArithmeticOperation::Sub, lhs_obj, rhs_obj);
 }
 
 ObjectHolder Mult::Execute(Closure& closure, Context& context) {
     ObjectHolder lhs_obj = lhs_->Execute(closure, context);
     ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-    if (!(lhs_obj && rhs_obj)) {
-        throw runtime_error("Attemp to Multiply wrong object types"s);
-    }
-
-    if (lhs_obj.TryAs<runtime::Number>() && rhs_obj.TryAs<runtime::Number>()) {
-        return ObjectHolder::Own(runtime::Number(lhs_obj.TryAs<runtime::Number>()->GetValue()
-                                 * rhs_obj.TryAs<runtime::Number>()->GetValue()));
-    }
-
-    throw runtime_error("Attemp to Multiply wrong object types"s);
+    return runtime::Arithmetic(runtime::ArithmeticOperation::Mult, lhs_obj, rhs_obj);
 }
 
 ObjectHolder Div::Execute(Closure& closure, Context& context) {
     ObjectHolder lhs_obj = lhs_->Execute(closure, context);
     ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-    if (!(lhs_obj && rhs_obj)) {
-        throw runtime_error("Attemp to Divide wrong object types"s);
-    }
-
-    if (lhs_obj.TryAs<runtime::Number>() && rhs_obj.TryAs<runtime::Number>()) {
-        return ObjectHolder::Own(runtime::Number(lhs_obj.TryAs<runtime::Number>()->GetValue()
-                                 / rhs_obj.TryAs<runtime::Number>()->GetValue()));
-    }
-
-    throw runtime_error("Attemp to Divide wrong object types"s);
+    return runtime::Arithmetic(runtime::ArithmeticOperation::Div, lhs_obj, rhs_obj);
 }
 
 ObjectHolder Compound::Execute(Closure& closure, Context& context) {
     for (const std::unique_ptr<Statement>& statemant : statements_) {
-        statemant->Execute(closure, context);
+        ObjectHolder result = statemant->Execute(closure, context);
+        // Результат return передаётся вверх до тела метода
+        if (context.IsReturning()) {
+            return result;
+        }
     }
 
     return ObjectHolder::None();
 }
 
 ObjectHolder Return::Execute(Closure& closure, Context& context) {
-    throw ReturnException(statement_->Execute(closure, context));
+    ObjectHolder result = statement_->Execute(closure, context);
+    context.SetReturning(true);
+    return result;
 }
 
 ClassDefinition::ClassDefinition(ObjectHolder cls)
@@ -219,22 +241,22 @@ ObjectHolder ClassDefinition::Execute(Closure& closure, Context& /*context*/) {
     return cls_;
 }
 
-FieldAssignment::FieldAssignment(VariableValue object, std::string field_name,
+FieldAssignment::FieldAssignment(VariableValue object, runtime::Symbol field_name,
                                  std::unique_ptr<Statement> rv)
     : object_(std::move(object))
-    , field_name_(std::move(field_name))
+    , field_name_(field_name)
     , rv_(std::move(rv))
 { /* do nothing */ }
 
 ObjectHolder FieldAssignment::Execute(Closure& closure, Context& context) {
-    Closure* closure_ptr = &closure;
-
-    for (const string& id : object_.GetIds()) {
-        closure_ptr = &closure_ptr->at(id).TryAs<runtime::ClassInstance>()->Fields();
+    ObjectHolder object = object_.Execute(closure, context);
+    auto* instance = object.TryAs<runtime::ClassInstance>();
+    if (instance == nullptr) {
+        throw runtime_error("Attemp to assign field "s + field_name_ + " of non-object value"s);
     }
 
-    (*closure_ptr)[field_name_] = rv_->Execute(closure, context);
-    return closure_ptr->at(field_name_);
+    ObjectHolder value = rv_->Execute(closure, context);
+    return instance->SetField(field_name_, std::move(value), cache_);
 }
 
 IfElse::IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
@@ -257,26 +279,30 @@ ObjectHolder IfElse::Execute(Closure& closure, Context& context) {
     return ObjectHolder::None();
 }
 
-ObjectHolder Or::Execute(Closure& closure, Context& context) {
-    ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-    ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-    if (lhs_obj && rhs_obj) {
-        return ObjectHolder::Own(runtime::Bool{ IsTrue(lhs_obj) || IsTrue(rhs_obj) });
+namespace {
+// Вычисляет операнд логической операции operation_name и приводит его к bool.
+// Если значение операнда равно None - выбрасывает runtime_error
+bool ExecuteLogicalOperand(Statement& operand, Closure& closure, Context& context,
+                           const char* operation_name) {
+    ObjectHolder value = operand.Execute(closure, context);
+    if (!value) {
+        throw runtime_error("Attemp to call operator "s + operation_name
+                            + " for wrong object types"s);
     }
+    return IsTrue(value);
+}
+}  // namespace
 
-    throw runtime_error("Attemp to call operator Or for wrong object types"s);
+ObjectHolder Or::Execute(Closure& closure, Context& context) {
+    const bool result = ExecuteLogicalOperand(*lhs_, closure, context, "Or")
+        || ExecuteLogicalOperand(*rhs_, closure, context, "Or");
+    return ObjectHolder::Own(runtime::Bool{ result });
 }
 
 ObjectHolder And::Execute(Closure& closure, Context& context) {
-    ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-    ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-    if (lhs_obj && rhs_obj) {
-        return ObjectHolder::Own(runtime::Bool{ IsTrue(lhs_obj) && IsTrue(rhs_obj) });
-    }
-
-    throw runtime_error("Attemp to call operator And for wrong object types"s);
+    const bool result = ExecuteLogicalOperand(*lhs_, closure, context, "And")
+        && ExecuteLogicalOperand(*rhs_, closure, context, "And");
+    return ObjectHolder::Own(runtime::Bool{ result });
 }
 
 ObjectHolder Not::Execute(Closure& closure, Context& context) {
@@ -291,13 +317,13 @@ ObjectHolder Not::Execute(Closure& closure, Context& context) {
 
 Comparison::Comparison(Comparator cmp, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
     : BinaryOperation(std::move(lhs), std::move(rhs))
-    , cmp_(std::move(cmp))
+    , cmp_(cmp)
 { /* do nothing */ }
 
 ObjectHolder Comparison::Execute(Closure& closure, Context& context) {
     ObjectHolder lhs_obj = lhs_->Execute(closure, context);
     ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-    return ObjectHolder::Own(runtime::Bool{ cmp_(lhs_obj, rhs_obj, context) });
+    return ObjectHolder::Own(runtime::Bool{ runtime::Compare(cmp_, lhs_obj, rhs_obj, context) });
 }
 
 NewInstance::NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args)
@@ -309,22 +335,17 @@ NewInstance::NewInstance(const runtime::Class& class_)
 { /* do nothing */ }
 
 ObjectHolder NewInstance::Execute(Closure& closure, Context& context) {
-    string class_name = class_.GetName();
-    closure[class_.GetName()] = ObjectHolder::Own(runtime::ClassInstance(class_));
-
-    runtime::ClassInstance* class_ptr = const_cast<runtime::ClassInstance*>(
-                closure.at(class_name).TryAs<runtime::ClassInstance>()
-                );
-
-    if (class_ptr->HasMethod(INIT_METHOD, args_.size())) {
-        vector<ObjectHolder> actual_args;
-        for (const std::unique_ptr<Statement>& arg : args_) {
-            actual_args.push_back(arg->Execute(closure, context));
-        }
-        class_ptr->Call(INIT_METHOD, actual_args, context);
+    runtime::GarbageCollector::AtSafePoint();
+    ObjectHolder instance = ObjectHolder::Own(runtime::ClassInstance(class_));
+    auto* instance_ptr = instance.TryAs<runtime::ClassInstance>();
+
+    const runtime::Method* init = instance_ptr->GetSpecialMethod(runtime::SpecialMethod::Init,
+                                                                 args_.size());
+    if (init != nullptr) {
+        CallMethod(*instance_ptr, *init, args_, closure, context);
     }
 
-    return closure.at(class_name);
+    return instance;
 }
 
 MethodBody::MethodBody(std::unique_ptr<Statement>&& body)
@@ -332,11 +353,18 @@ MethodBody::MethodBody(std::unique_ptr<Statement>&& body)
 { /* do nothing */ }
 
 ObjectHolder MethodBody::Execute(Closure& closure, Context& context) {
-    try {
-        return body_->Execute(closure, context);
-    }  catch (const ReturnException& ex) {
-        return ex.GetResult();
-    }
+    ObjectHolder result = body_->Execute(closure, context);
+    context.SetReturning(false);
+    return result;
+}
+
+Program::Program(std::shared_ptr<runtime::Arena> arena, std::unique_ptr<Statement> root)
+    : arena_(std::move(arena))
+    , root_(std::move(root))
+{ /* do nothing */ }
+
+ObjectHolder Program::Execute(Closure& closure, Context& context) {
+    return root_->Execute(closure, context);
 }
 
 }  // namespace ast
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "arena.h"
 #include "runtime.h"
 
-#include <functional>
+#include <optional>
+#include <type_traits>
 
 namespace ast {
 
 using Statement = runtime::Executable;
 
+class Optimizer;
+
 // Выражение, возвращающее значение типа T,
 // используется как основа для создания констант
 template <typename T>
@@ -17,9 +21,17 @@ public:
         : value_(std::move(v)) {
     }
 
+    const T& GetValue() const { return value_; }
+
     runtime::ObjectHolder Execute(runtime::Closure& /*closure*/,
                                   runtime::Context& /*context*/) override {
-        return runtime::ObjectHolder::Share(value_);
+        // Числа и логические значения копируются внутрь ObjectHolder без выделения памяти
+        if constexpr (std::is_same_v<T, runtime::Number> || std::is_same_v<T, runtime::Bool>) {
+            return runtime::ObjectHolder::Own(T(value_));
+        }
+        else {
+            return runtime::ObjectHolder::Share(value_);
+        }
     }
 
 private:
@@ -34,43 +46,68 @@ using BoolConst = ValueStatement<runtime::Bool>;
 Вычисляет значение переменной либо цепочки вызовов полей объектов id1.id2.id3.
 Например, выражение circle.center.x - цепочка вызовов полей объектов в инструкции:
 x = circle.center.x
+
+Если при разборе первому идентификатору цепочки назначен слот кадра метода,
+его значение берётся из кадра context.GetFrame(), иначе - из closure
 */
 class VariableValue : public Statement {
 public:
-    explicit VariableValue(const std::string& var_name);
-    explicit VariableValue(std::vector<std::string> dotted_ids);
+    explicit VariableValue(runtime::Symbol var_name);
+    explicit VariableValue(const std::vector<std::string>& dotted_ids);
+    explicit VariableValue(std::vector<runtime::Symbol> dotted_ids);
+    VariableValue(std::vector<runtime::Symbol> dotted_ids, size_t slot);
 
-    const std::vector<std::string>& GetIds() const { return dotted_ids_; }
+    const std::vector<runtime::Symbol>& GetIds() const { return dotted_ids_; }
+    const std::optional<size_t>& GetSlot() const { return slot_; }
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
 private:
-    std::vector<std::string> dotted_ids_; // Цепочка вызовов полей объектов
+    std::vector<runtime::Symbol> dotted_ids_; // Цепочка вызовов полей объектов
+    std::optional<size_t> slot_;          // Слот первого идентификатора в кадре метода
+    std::vector<runtime::FieldCache> field_caches_; // Кэши доступа к полям цепочки
 };
 
 // Присваивает переменной, имя которой задано в параметре var, значение выражения rv
 class Assignment : public Statement {
 public:
-    Assignment(std::string var, std::unique_ptr<Statement> rv);
+    Assignment(runtime::Symbol var, std::unique_ptr<Statement> rv);
+    // Присваивает значение слоту slot кадра метода
+    Assignment(runtime::Symbol var, std::unique_ptr<Statement> rv, size_t slot);
+
+    runtime::Symbol GetVarName() const { return var_; }
+    const Statement& GetRvalue() const { return *rv_; }
+    const std::optional<size_t>& GetSlot() const { return slot_; }
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
-    std::string var_;               // Имя переменной
+    runtime::Symbol var_;           // Имя переменной
     std::unique_ptr<Statement> rv_; // Указатель на выражение
+    std::optional<size_t> slot_;    // Слот переменной в кадре метода
 };
 
 // Присваивает полю object.field_name значение выражения rv
 class FieldAssignment : public Statement {
 public:
-    FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
+    FieldAssignment(VariableValue object, runtime::Symbol field_name,
+                    std::unique_ptr<Statement> rv);
+
+    const VariableValue& GetObject() const { return object_; }
+    runtime::Symbol GetFieldName() const { return field_name_; }
+    const Statement& GetRvalue() const { return *rv_; }
 
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
     VariableValue object_;
-    std::string field_name_;
+    runtime::Symbol field_name_;
     std::unique_ptr<Statement> rv_;
+    runtime::FieldCache cache_; // Кэш записи поля
 };
 
 // Значение None
@@ -93,10 +130,14 @@ public:
     // Инициализирует команду print для вывода значения переменной name
     static std::unique_ptr<Print> Variable(const std::string& name);
 
+    const std::vector<std::unique_ptr<Statement>>& GetArgs() const { return args_; }
+
     // Во время выполнения команды print вывод должен осуществляться в поток, возвращаемый из
     // context.GetOutputStream()
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
     std::vector<std::unique_ptr<Statement>> args_;
 };
@@ -104,15 +145,23 @@ private:
 // Вызывает метод object.method со списком параметров args
 class MethodCall : public Statement {
 public:
-    MethodCall(std::unique_ptr<Statement> object, std::string method,
+    MethodCall(std::unique_ptr<Statement> object, runtime::Symbol method,
                std::vector<std::unique_ptr<Statement>> args);
 
+    const Statement& GetObject() const { return *object_; }
+    runtime::Symbol GetMethodName() const { return method_; }
+    const std::vector<std::unique_ptr<Statement>>& GetArgs() const { return args_; }
+
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
-    std::string method_;                           // Название метода
+    runtime::Symbol method_;                       // Название метода
+    runtime::MethodId method_id_;                  // Идентификатор названия метода
     std::unique_ptr<Statement> object_;            // Указатель на объект класса
     std::vector<std::unique_ptr<Statement>> args_; // Список указателей на объекты-аргументы
+    runtime::MethodCache cache_;                   // Кэш методов по классам получателя
 };
 
 /*
@@ -132,9 +181,15 @@ class NewInstance : public Statement {
 public:
     explicit NewInstance(const runtime::Class& class_);
     NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args);
+
+    const runtime::Class& GetClass() const { return class_; }
+    const std::vector<std::unique_ptr<Statement>>& GetArgs() const { return args_; }
+
     // Возвращает объект, содержащий значение типа ClassInstance
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
     const runtime::Class& class_;                  // Ссылка на объект класса
     std::vector<std::unique_ptr<Statement>> args_; // Вектор указателей на поля класса
@@ -147,6 +202,10 @@ public:
         : argument_(std::move(argument))
     { /* do nothing */ }
 
+    const Statement& GetArgument() const { return *argument_; }
+
+    friend class Optimizer;
+
 protected:
     std::unique_ptr<Statement> argument_;
 };
@@ -166,6 +225,11 @@ public:
         , rhs_(std::move(rhs))
     { /* do nothing */ }
 
+    const Statement& GetLhs() const { return *lhs_; }
+    const Statement& GetRhs() const { return *rhs_; }
+
+    friend class Optimizer;
+
 protected:
     std::unique_ptr<Statement> lhs_;
     std::unique_ptr<Statement> rhs_;
@@ -257,9 +321,14 @@ public:
         statements_.push_back(std::move(stmt));
     }
 
-    // Последовательно выполняет добавленные инструкции. Возвращает None
+    const std::vector<std::unique_ptr<Statement>>& GetStatements() const { return statements_; }
+
+    // Последовательно выполняет добавленные инструкции. Возвращает None.
+    // Если одна из инструкций выполнила return, прекращает выполнение и возвращает её результат
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
     void UnpackArgs() {}
 
@@ -280,25 +349,17 @@ class MethodBody : public Statement {
 public:
     explicit MethodBody(std::unique_ptr<Statement>&& body);
 
+    const Statement& GetBody() const { return *body_; }
+
     // Вычисляет инструкцию, переданную в качестве body.
     // Если внутри body была выполнена инструкция return, возвращает результат return
     // В противном случае возвращает None
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
-private:
-    std::unique_ptr<Statement> body_;
-};
-
-class ReturnException final : public std::exception {
-public:
-    explicit ReturnException(runtime::ObjectHolder return_result)
-        : return_result_(std::move(return_result))
-    { /* do nothing */ }
-
-    const runtime::ObjectHolder& GetResult() const { return return_result_; }
+    friend class Optimizer;
 
 private:
-    runtime::ObjectHolder return_result_;
+    std::unique_ptr<Statement> body_;
 };
 
 // Выполняет инструкцию return с выражением statement
@@ -308,10 +369,16 @@ public:
         : statement_(std::move(statement))
     { /* do nothing */ }
 
+    const Statement& GetStatement() const { return *statement_; }
+
     // Останавливает выполнение текущего метода. После выполнения инструкции return метод,
     // внутри которого она была исполнена, должен вернуть результат вычисления выражения statement.
+    // Возвращает этот результат и устанавливает в context признак IsReturning,
+    // по которому Compound прекращает выполнение, а MethodBody сбрасывает признак
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
     std::unique_ptr<Statement> statement_;
 };
@@ -322,6 +389,8 @@ public:
     // Гарантируется, что ObjectHolder содержит объект типа runtime::Class
     explicit ClassDefinition(runtime::ObjectHolder cls);
 
+    const runtime::ObjectHolder& GetClass() const { return cls_; }
+
     // Создаёт внутри closure новый объект, совпадающий с именем класса и значением, переданным в
     // конструктор
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
@@ -337,8 +406,15 @@ public:
     IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
            std::unique_ptr<Statement> else_body);
 
+    const Statement& GetCondition() const { return *condition_; }
+    const Statement& GetIfBody() const { return *if_body_; }
+    // Возвращает nullptr, если ветка else отсутствует
+    const Statement* GetElseBody() const { return else_body_.get(); }
+
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
+    friend class Optimizer;
+
 private:
     std::unique_ptr<Statement> condition_;
     std::unique_ptr<Statement> if_body_;
@@ -348,13 +424,14 @@ private:
 // Операция сравнения
 class Comparison : public BinaryOperation {
 public:
-    // Comparator задаёт функцию, выполняющую сравнение значений аргументов
-    using Comparator = std::function<bool(const runtime::ObjectHolder&,
-                                          const runtime::ObjectHolder&, runtime::Context&)>;
+    // Comparator задаёт вид сравнения значений аргументов
+    using Comparator = runtime::Comparator;
 
     Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
 
-    // Вычисляет значение выражений lhs и rhs и возвращает результат работы comparator,
+    Comparator GetComparator() const { return cmp_; }
+
+    // Вычисляет значение выражений lhs и rhs и возвращает результат сравнения comparator,
     // приведённый к типу runtime::Bool
     runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
 
@@ -362,4 +439,26 @@ private:
     Comparator cmp_;
 };
 
+/*
+Программа, построенная ParseProgram. Владеет корневой инструкцией и ареной,
+в которой размещены узлы AST, поэтому узлы программы располагаются в памяти рядом.
+Узлы разрушаются владеющими ими указателями, а их память возвращается блоками арены
+*/
+class Program : public Statement {
+public:
+    Program(std::shared_ptr<runtime::Arena> arena, std::unique_ptr<Statement> root);
+
+    const Statement& GetRoot() const { return *root_; }
+    const runtime::Arena& GetArena() const { return *arena_; }
+
+    // Выполняет корневую инструкцию программы
+    runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+    friend class Optimizer;
+
+private:
+    std::shared_ptr<runtime::Arena> arena_; // Объявлена первой, чтобы пережить узлы AST
+    std::unique_ptr<Statement> root_;
+};
+
 }  // namespace ast
@@ -308,6 +308,29 @@ void TestCompound() {
     ASSERT(context.output.str().empty());
 }
 
+void TestReturn() {
+    runtime::DummyContext context;
+
+    // return внутри ветки if прерывает выполнение тела метода
+    MethodBody body{make_unique<Compound>(
+        make_unique<IfElse>(make_unique<BoolConst>(true),
+                            make_unique<Compound>(make_unique<Return>(make_unique<NumericConst>(1)),
+                                                  make_unique<Print>(make_unique<StringConst>("if"s))),
+                            nullptr),
+        make_unique<Print>(make_unique<StringConst>("after"s)))};
+
+    Closure closure;
+    auto result = body.Execute(closure, context);
+    ASSERT_OBJECT_VALUE_EQUAL(result, 1);
+    ASSERT(!context.IsReturning());
+    ASSERT(context.output.str().empty());
+
+    // Без return тело метода возвращает None
+    MethodBody empty_body{make_unique<Compound>(make_unique<Print>(make_unique<StringConst>("x"s)))};
+    ASSERT(!empty_body.Execute(closure, context));
+    ASSERT_EQUAL(context.output.str(), "x\n"s);
+}
+
 void TestFields() {
     runtime::DummyContext context;
 
@@ -439,6 +462,22 @@ void TestAnd() {
     test_and(false, false);
 }
 
+void TestLogicalShortCircuit() {
+    Closure closure;
+    runtime::DummyContext context;
+
+    // Правый операнд не вычисляется, если результат определён левым
+    Or or_statement{make_unique<BoolConst>(true), make_unique<VariableValue>("undefined"s)};
+    ASSERT(runtime::IsTrue(or_statement.Execute(closure, context)));
+    And and_statement{make_unique<BoolConst>(false), make_unique<VariableValue>("undefined"s)};
+    ASSERT(!runtime::IsTrue(and_statement.Execute(closure, context)));
+
+    Or or_evaluated{make_unique<BoolConst>(false), make_unique<VariableValue>("undefined"s)};
+    ASSERT_THROWS(or_evaluated.Execute(closure, context), runtime_error);
+    And and_none{make_unique<None>(), make_unique<BoolConst>(true)};
+    ASSERT_THROWS(and_none.Execute(closure, context), runtime_error);
+}
+
 void TestNot() {
     auto test_not = [](bool arg) {
         Not not_statement{make_unique<BoolConst>(arg)};
@@ -470,11 +509,13 @@ void RunUnitTests(TestRunner& tr) {
     RUN_TEST(tr, ast::TestSuccessfulClassInstanceAdd);
     RUN_TEST(tr, ast::TestClassInstanceAddWithoutMethod);
     RUN_TEST(tr, ast::TestCompound);
+    RUN_TEST(tr, ast::TestReturn);
     RUN_TEST(tr, ast::TestFields);
     RUN_TEST(tr, ast::TestBaseClass);
     RUN_TEST(tr, ast::TestInheritance);
     RUN_TEST(tr, ast::TestOr);
     RUN_TEST(tr, ast::TestAnd);
+    RUN_TEST(tr, ast::TestLogicalShortCircuit);
     RUN_TEST(tr, ast::TestNot);
 }
 
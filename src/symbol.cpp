@@ -0,0 +1,93 @@
+#include "symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+using namespace std;
+
+namespace runtime {
+
+namespace {
+// Глобальная таблица символов. Добавление защищено мьютексом,
+// поэтому имена можно интернировать из нескольких потоков.
+// Пустое имя имеет номер 0 и хранится вне таблицы
+class SymbolTable {
+public:
+    const Symbol::Entry* Intern(string_view name) {
+        lock_guard guard(mutex_);
+        auto it = entries_by_name_.find(name);
+        if (it != entries_by_name_.end()) {
+            return it->second;
+        }
+        const Symbol::Entry& entry = entries_.emplace_back(
+            Symbol::Entry{string(name), static_cast<uint32_t>(entries_.size() + 1)});
+        // Ключ ссылается на строку записи, адрес которой в deque не меняется
+        entries_by_name_.emplace(entry.name, &entry);
+        return &entry;
+    }
+
+    size_t GetCount() {
+        lock_guard guard(mutex_);
+        return entries_.size() + 1;
+    }
+
+private:
+    mutex mutex_;
+    deque<Symbol::Entry> entries_;
+    unordered_map<string_view, const Symbol::Entry*> entries_by_name_;
+};
+
+SymbolTable& GetSymbolTable() {
+    static SymbolTable table;
+    return table;
+}
+
+// Записи, уже найденные текущим потоком. Ключи ссылаются на строки записей
+// глобальной таблицы, поэтому остаются действительными после завершения потока
+thread_local unordered_map<string_view, const Symbol::Entry*> thread_entries;
+}  // namespace
+
+const Symbol::Entry* Symbol::Intern(string_view name) {
+    if (name.empty()) {
+        return &GetEmptyEntry();
+    }
+    auto it = thread_entries.find(name);
+    if (it != thread_entries.end()) {
+        return it->second;
+    }
+    const Entry* entry = GetSymbolTable().Intern(name);
+    thread_entries.emplace(entry->name, entry);
+    return entry;
+}
+
+Symbol::Symbol(string_view name)
+    : entry_(Intern(name)) {
+}
+
+Symbol::Symbol(const string& name)
+    : Symbol(string_view{name}) {
+}
+
+Symbol::Symbol(const char* name)
+    : Symbol(string_view{name}) {
+}
+
+size_t Symbol::GetCount() {
+    return GetSymbolTable().GetCount();
+}
+
+ostream& operator<<(ostream& os, Symbol symbol) {
+    return os << symbol.GetName();
+}
+
+string operator+(const string& lhs, Symbol rhs) {
+    return lhs + rhs.GetName();
+}
+
+string operator+(Symbol lhs, const string& rhs) {
+    return lhs.GetName() + rhs;
+}
+
+}  // namespace runtime
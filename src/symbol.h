@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace runtime {
+
+/*
+ * Интернированное имя: идентификатор переменной, имя поля, метода или параметра.
+ * Каждое имя хранится в глобальной таблице символов один раз, а символ содержит только
+ * указатель на запись таблицы. Поэтому символы копируются, сравниваются и хешируются
+ * без обращения к строке. Записи таблицы не удаляются до завершения программы.
+ * Каждый поток запоминает найденные им записи, поэтому общую таблицу, защищённую
+ * мьютексом, поток просматривает только при первой встрече с именем
+ */
+class Symbol {
+public:
+    // Создаёт символ пустого имени. Запись пустого имени создаётся заранее,
+    // поэтому конструктор не обращается к таблице символов
+    Symbol() noexcept
+        : entry_(&GetEmptyEntry()) {
+    }
+
+    // Возвращают символ имени name, добавляя имя в таблицу символов при первом обращении
+    Symbol(std::string_view name);   // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+    Symbol(const std::string& name); // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+    Symbol(const char* name);        // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+
+    [[nodiscard]] const std::string& GetName() const {
+        return entry_->name;
+    }
+
+    // Возвращает номер символа. Символы нумеруются подряд в порядке добавления в таблицу
+    [[nodiscard]] std::uint32_t GetId() const {
+        return entry_->id;
+    }
+
+    friend bool operator==(Symbol lhs, Symbol rhs) {
+        return lhs.entry_ == rhs.entry_;
+    }
+
+    friend bool operator!=(Symbol lhs, Symbol rhs) {
+        return lhs.entry_ != rhs.entry_;
+    }
+
+    // Возвращает количество символов в таблице
+    [[nodiscard]] static size_t GetCount();
+
+    // Запись таблицы символов
+    struct Entry {
+        std::string name;
+        std::uint32_t id;
+    };
+
+private:
+    // Возвращает запись имени name, добавляя её в таблицу символов при первом обращении
+    static const Entry* Intern(std::string_view name);
+
+    // Запись пустого имени, имеющая номер 0
+    static const Entry& GetEmptyEntry() noexcept {
+        static const Entry empty{std::string(), 0};
+        return empty;
+    }
+
+    const Entry* entry_;
+};
+
+std::ostream& operator<<(std::ostream& os, Symbol symbol);
+
+// Возвращает конкатенацию строки и имени символа
+std::string operator+(const std::string& lhs, Symbol rhs);
+std::string operator+(Symbol lhs, const std::string& rhs);
+
+}  // namespace runtime
+
+namespace std {
+// Хеш символа - его номер, назначенный при добавлении в таблицу
+template <>
+struct hash<runtime::Symbol> {
+    size_t operator()(runtime::Symbol symbol) const noexcept {
+        return symbol.GetId();
+    }
+};
+}  // namespace std
@@ -0,0 +1,287 @@
+#include "vm.h"
+
+#include "flat_interpreter.h"
+#include "gc.h"
+
+using namespace std;
+
+namespace bytecode {
+
+using runtime::Closure;
+using runtime::ObjectHolder;
+
+namespace {
+const runtime::Symbol SELF{"self"sv};
+}  // namespace
+
+VirtualMachine::VirtualMachine(runtime::Context& context)
+    : context_(context)
+{ /* do nothing */ }
+
+auto VirtualMachine::CallWithoutArguments() {
+    return [this](runtime::ClassInstance& instance, const runtime::Method& method) {
+        return CallMethod(instance, method, stack_.size());
+    };
+}
+
+ObjectHolder VirtualMachine::Run(const Chunk& chunk, Closure& closure) {
+    // При любом выходе из фрагмента стек операндов возвращается к исходному размеру
+    struct StackGuard {
+        vector<ObjectHolder>& stack;
+        size_t base;
+        ~StackGuard() {
+            stack.resize(base);
+        }
+    } guard{stack_, stack_.size()};
+
+    auto pop = [this]() {
+        ObjectHolder value = std::move(stack_.back());
+        stack_.pop_back();
+        return value;
+    };
+
+    size_t pc = 0;
+    while (true) {
+        const Instruction& instr = chunk.code[pc++];
+
+        switch (instr.op) {
+        case OpCode::LoadConst:
+            stack_.push_back(chunk.constants[instr.a]);
+            break;
+        case OpCode::LoadNone:
+            stack_.emplace_back();
+            break;
+        case OpCode::LoadName: {
+            auto it = closure.find(chunk.names[instr.a]);
+            if (it == closure.end()) {
+                throw runtime_error("Wrong var name: "s + chunk.names[instr.a]);
+            }
+            stack_.push_back(it->second);
+            break;
+        }
+        case OpCode::StoreName:
+            closure[chunk.names[instr.a]] = stack_.back();
+            break;
+        case OpCode::LoadSlot: {
+            const optional<ObjectHolder>& value = (*context_.GetFrame())[instr.a];
+            if (!value) {
+                throw runtime_error("Wrong var name: "s + chunk.names[instr.b]);
+            }
+            stack_.push_back(*value);
+            break;
+        }
+        case OpCode::StoreSlot:
+            (*context_.GetFrame())[instr.a] = stack_.back();
+            break;
+        case OpCode::LoadField: {
+            const FieldSite& site = chunk.field_sites[instr.a];
+            const runtime::Symbol name = chunk.names[site.name];
+            if (stack_.back().GetType() != runtime::ObjectType::ClassInstance) {
+                throw runtime_error("Wrong var name: "s + name);
+            }
+            auto* instance = static_cast<runtime::ClassInstance*>(stack_.back().Get());
+            const ObjectHolder* field = instance->FindField(name, site.cache);
+            if (field == nullptr) {
+                throw runtime_error("Wrong var name: "s + name);
+            }
+            stack_.back() = *field;
+            break;
+        }
+        case OpCode::StoreField: {
+            const FieldSite& site = chunk.field_sites[instr.a];
+            ObjectHolder value = pop();
+            if (stack_.back().GetType() != runtime::ObjectType::ClassInstance) {
+                throw runtime_error("Attemp to assign field "s + chunk.names[site.name]
+                                    + " of non-object value"s);
+            }
+            auto* instance = static_cast<runtime::ClassInstance*>(stack_.back().Get());
+            instance->SetField(chunk.names[site.name], value, site.cache);
+            stack_.back() = std::move(value);
+            break;
+        }
+        case OpCode::Pop:
+            stack_.pop_back();
+            break;
+        case OpCode::PrintValue: {
+            ObjectHolder value = pop();
+            auto& output = context_.GetOutputStream();
+            if (instr.a != 0) {
+                output << ' ';
+            }
+            runtime::PrintValue(value, output, context_, CallWithoutArguments());
+            break;
+        }
+        case OpCode::PrintNewline:
+            context_.GetOutputStream() << '\n';
+            stack_.emplace_back();
+            break;
+        case OpCode::Stringify:
+            stack_.back() = runtime::Stringify(stack_.back(), context_, CallWithoutArguments());
+            break;
+        case OpCode::Add: {
+            ObjectHolder rhs = pop();
+            stack_.back() = runtime::Add(stack_.back(), rhs,
+                                         [this, &rhs](runtime::ClassInstance& instance,
+                                                      const runtime::Method& method) {
+                                             stack_.push_back(rhs);
+                                             return CallMethod(instance, method, stack_.size() - 1);
+                                         });
+            break;
+        }
+        case OpCode::Sub: {
+            ObjectHolder rhs = pop();
+            stack_.back() = runtime::Arithmetic(runtime::ArithmeticOperation::Sub,
+                                                stack_.back(), rhs);
+            break;
+        }
+        case OpCode::Mult: {
+            ObjectHolder rhs = pop();
+            stack_.back() = runtime::Arithmetic(runtime::ArithmeticOperation::Mult,
+                                                stack_.back(), rhs);
+            break;
+        }
+        case OpCode::Div: {
+            ObjectHolder rhs = pop();
+            stack_.back() = runtime::Arithmetic(runtime::ArithmeticOperation::Div,
+                                                stack_.back(), rhs);
+            break;
+        }
+        case OpCode::ToBool:
+            if (!stack_.back()) {
+                throw runtime_error("Attemp to call logical operator for wrong object types"s);
+            }
+            stack_.back() = ObjectHolder::Own(runtime::Bool{IsTrue(stack_.back())});
+            break;
+        case OpCode::Not:
+            if (!stack_.back()) {
+                throw runtime_error("Wrong argument parsed to Not"s);
+            }
+            stack_.back() = ObjectHolder::Own(runtime::Bool{!IsTrue(stack_.back())});
+            break;
+        case OpCode::Compare: {
+            ObjectHolder rhs = pop();
+            const bool result = runtime::Compare(static_cast<runtime::Comparator>(instr.a),
+                                                 stack_.back(), rhs, context_);
+            stack_.back() = ObjectHolder::Own(runtime::Bool{result});
+            break;
+        }
+        case OpCode::Jump:
+            pc = instr.a;
+            break;
+        case OpCode::JumpIfFalse:
+            if (!IsTrue(pop())) {
+                pc = instr.a;
+            }
+            break;
+        case OpCode::JumpIfFalseOrPop:
+        case OpCode::JumpIfTrueOrPop:
+            // Значение операнда уже приведено к Bool инструкцией ToBool
+            if (IsTrue(stack_.back()) == (instr.op == OpCode::JumpIfTrueOrPop)) {
+                pc = instr.a;
+            }
+            else {
+                stack_.pop_back();
+            }
+            break;
+        case OpCode::CallMethod: {
+            const size_t args_begin = stack_.size() - instr.b;
+            ObjectHolder object = stack_[args_begin - 1];
+            runtime::ClassInstance* instance = nullptr;
+            const runtime::Method* method = nullptr;
+            if (object.GetType() == runtime::ObjectType::ClassInstance) {
+                const CallSite& site = chunk.call_sites[instr.a];
+                instance = static_cast<runtime::ClassInstance*>(object.Get());
+                method = site.cache.Lookup(instance->GetClass(), site.method_id);
+            }
+
+            ObjectHolder result;
+            if (method != nullptr && method->formal_params.size() == instr.b) {
+                result = CallMethod(*instance, *method, args_begin);
+            }
+            stack_.resize(args_begin - 1);
+            stack_.push_back(std::move(result));
+            break;
+        }
+        case OpCode::NewInstance: {
+            const size_t args_begin = stack_.size() - instr.b;
+            runtime::GarbageCollector::AtSafePoint();
+            const runtime::Class& cls = *chunk.classes[instr.a];
+            ObjectHolder instance = ObjectHolder::Own(runtime::ClassInstance(cls));
+
+            const runtime::Method* init = cls.GetSpecialMethod(runtime::SpecialMethod::Init);
+            if (init != nullptr && init->formal_params.size() == instr.b) {
+                CallMethod(*instance.TryAs<runtime::ClassInstance>(), *init, args_begin);
+            }
+            stack_.resize(args_begin);
+            stack_.push_back(std::move(instance));
+            break;
+        }
+        case OpCode::DefineClass: {
+            const ObjectHolder& cls = chunk.constants[instr.a];
+            closure[cls.TryAs<runtime::Class>()->GetName()] = cls;
+            stack_.push_back(cls);
+            break;
+        }
+        case OpCode::ExecAst: {
+            // Узлы AST не изменяются при исполнении, поэтому снятие const безопасно
+            auto* node = const_cast<runtime::Executable*>(chunk.nodes[instr.a]);
+            stack_.push_back(node->Execute(closure, context_));
+            break;
+        }
+        case OpCode::Return:
+            return pop();
+        }
+    }
+}
+
+ObjectHolder VirtualMachine::CallMethod(runtime::ClassInstance& instance,
+                                        const runtime::Method& method, size_t args_begin) {
+    unique_ptr<Chunk>& chunk = method_chunks_[&method];
+    if (!chunk) {
+        method.Prepare();
+        chunk = make_unique<Chunk>(Compiler::CompileMethod(method));
+    }
+
+    // Метод с разрешёнными при разборе переменными исполняется в кадре
+    if (method.frame_size > 0) {
+        runtime::PooledFrame frame(method.frame_size);
+        (*frame)[0] = ObjectHolder::Share(instance);
+        for (size_t i = 0; i < method.formal_params.size(); ++i) {
+            (*frame)[i + 1] = std::move(stack_[args_begin + i]);
+        }
+        stack_.resize(args_begin);
+
+        runtime::FrameScope frame_scope(context_, &*frame);
+        Closure unused_closure;
+        return Run(*chunk, unused_closure);
+    }
+
+    Closure method_vars;
+    method_vars[SELF] = ObjectHolder::Share(instance);
+    for (size_t i = 0; i < method.formal_params.size(); ++i) {
+        method_vars[method.formal_params[i]] = std::move(stack_[args_begin + i]);
+    }
+    stack_.resize(args_begin);
+
+    runtime::FrameScope frame_scope(context_, nullptr);
+    return Run(*chunk, method_vars);
+}
+
+ObjectHolder RunProgram(runtime::Executable& program, Closure& closure,
+                        runtime::Context& context, Engine engine) {
+    runtime::MemoryScope memory_scope(&context.GetMemory());
+    if (engine == Engine::TreeWalking) {
+        return program.Execute(closure, context);
+    }
+    if (engine == Engine::Flat) {
+        const flat::Tree tree = flat::Builder::Build(program);
+        flat::Interpreter interpreter(context);
+        return interpreter.Run(tree, closure);
+    }
+
+    const Chunk chunk = Compiler::Compile(program);
+    VirtualMachine vm(context);
+    return vm.Run(chunk, closure);
+}
+
+}  // namespace bytecode
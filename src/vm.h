@@ -0,0 +1,44 @@
+#pragma once
+
+#include "bytecode.h"
+#include "runtime.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace bytecode {
+
+// Стековая виртуальная машина, исполняющая байткод, построенный Compiler
+class VirtualMachine {
+public:
+    explicit VirtualMachine(runtime::Context& context);
+
+    // Исполняет фрагмент chunk в таблице символов closure, возвращает результат фрагмента
+    runtime::ObjectHolder Run(const Chunk& chunk, runtime::Closure& closure);
+
+private:
+    // Вызывает метод method у объекта instance. Тело метода компилируется при первом вызове
+    runtime::ObjectHolder CallMethod(runtime::ClassInstance& instance,
+                                     const runtime::Method& method, size_t args_begin);
+    // Возвращает функцию, вызывающую метод объекта без аргументов, для операций среды исполнения
+    auto CallWithoutArguments();
+
+    runtime::Context& context_;
+    std::vector<runtime::ObjectHolder> stack_; // Стек операндов, общий для всех вызовов
+    std::unordered_map<const runtime::Method*, std::unique_ptr<Chunk>> method_chunks_;
+};
+
+// Способ исполнения программы
+enum class Engine {
+    TreeWalking, // Обход AST виртуальными вызовами Executable::Execute
+    Bytecode,    // Компиляция в байткод и исполнение виртуальной машиной
+    Flat,        // Обход плоского AST, хранящего узлы в одном массиве
+};
+
+// Исполняет программу program выбранным движком engine.
+// Память, выделяемая программой, учитывается в счёте context.GetMemory()
+runtime::ObjectHolder RunProgram(runtime::Executable& program, runtime::Closure& closure,
+                                 runtime::Context& context, Engine engine);
+
+}  // namespace bytecode
@@ -0,0 +1,217 @@
+#include "lexer.h"
+#include "parse.h"
+#include "statement.h"
+#include "test_runner_p.h"
+#include "vm.h"
+
+using namespace std;
+
+namespace bytecode {
+
+namespace {
+
+string RunWithEngine(const string& program, Engine engine, bool lazy_methods = false) {
+    istringstream input(program);
+    parse::Lexer lexer(input);
+    auto tree = ParseProgram(lexer, lazy_methods);
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    RunProgram(*tree, closure, context, engine);
+    return context.output.str();
+}
+
+// Проверяет, что все движки выводят одинаковый результат, равный expected
+void AssertSameOutput(const string& program, const string& expected) {
+    ASSERT_EQUAL(RunWithEngine(program, Engine::TreeWalking), expected);
+    ASSERT_EQUAL(RunWithEngine(program, Engine::Bytecode), expected);
+    ASSERT_EQUAL(RunWithEngine(program, Engine::Flat), expected);
+    // Тела методов, разобранные при первом вызове, исполняются так же
+    ASSERT_EQUAL(RunWithEngine(program, Engine::TreeWalking, true), expected);
+    ASSERT_EQUAL(RunWithEngine(program, Engine::Bytecode, true), expected);
+    ASSERT_EQUAL(RunWithEngine(program, Engine::Flat, true), expected);
+}
+
+void TestCompileExpression() {
+    ast::Add sum(make_unique<ast::NumericConst>(2),
+                 make_unique<ast::Mult>(make_unique<ast::NumericConst>(3),
+                                        make_unique<ast::VariableValue>("x"s)));
+
+    Chunk chunk = Compiler::Compile(sum);
+
+    vector<OpCode> expected = {OpCode::LoadConst, OpCode::LoadConst, OpCode::LoadName,
+                               OpCode::Mult, OpCode::Add, OpCode::Return};
+    ASSERT_EQUAL(chunk.code.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT(chunk.code[i].op == expected[i]);
+    }
+    ASSERT_EQUAL(chunk.constants.size(), 2U);
+    ASSERT_EQUAL(chunk.names, vector<runtime::Symbol>{"x"s});
+
+    runtime::DummyContext context;
+    runtime::Closure closure{{"x"s, runtime::ObjectHolder::Own(runtime::Number(5))}};
+    VirtualMachine vm(context);
+    auto result = vm.Run(chunk, closure);
+    ASSERT(result.TryAs<runtime::Number>() != nullptr);
+    ASSERT_EQUAL(result.TryAs<runtime::Number>()->GetValue(), 17);
+}
+
+void TestVariablesAndPrint() {
+    AssertSameOutput(R"(
+x = 57
+y = 'hello'
+print x, y, None, True, 2*5+10/2
+print
+x = y
+print x + ', world', str(42) + str(None)
+)"s,
+                     "57 hello None True 15\n\nhello, world 42None\n"s);
+}
+
+void TestConditionsAndLogic() {
+    AssertSameOutput(R"(
+a = 1
+b = 2
+if a < b and not a == b:
+  print 'less'
+else:
+  print 'not less'
+if a >= b or a != 1:
+  print 'yes'
+else:
+  print 'no'
+print a <= b, a > b, 'abc' < 'abd'
+print a == 1 or undefined, a == 2 and undefined, 0 or 'x', 1 and 0
+)"s,
+                     "less\nno\nTrue False True\nTrue False True False\n"s);
+}
+
+void TestClassesAndMethods() {
+    AssertSameOutput(R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def area():
+    return self.w * self.h
+
+  def __str__():
+    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
+
+class Empty(Shape):
+  def nothing():
+    x = 1
+
+r = Rect(10, 20)
+e = Empty()
+print r, e, r.area(), e.nothing(), e.missing()
+r.w = 3
+print r.area()
+)"s,
+                     "Rect(10x20) Shape 200 None None\n60\n"s);
+}
+
+void TestRecursionAndReturn() {
+    AssertSameOutput(R"(
+class GCD:
+  def __init__():
+    self.call_count = 0
+
+  def calc(a, b):
+    self.call_count = self.call_count + 1
+    if a < b:
+      return self.calc(b, a)
+    if b == 0:
+      return a
+    return self.calc(a - b, b)
+
+x = GCD()
+print x.calc(510510, 18629977)
+print x.calc(22, 17)
+print x.call_count
+)"s,
+                     "17\n1\n115\n"s);
+}
+
+void TestUserDefinedOperators() {
+    AssertSameOutput(R"(
+class Value:
+  def __init__(v):
+    self.v = v
+
+  def __add__(rhs):
+    return self.v + rhs.v
+
+  def __eq__(rhs):
+    return self.v == rhs.v
+
+  def __lt__(rhs):
+    return self.v < rhs.v
+
+  def __str__():
+    return str(self.v)
+
+a = Value(2)
+b = Value(3)
+print a + b, a == b, a < b, a > b, a <= b
+)"s,
+                     "5 False True False True\n"s);
+}
+
+void TestTreeWalkingFallback() {
+    // Тело метода, не являющееся узлом AST, исполняется интерпретатором дерева
+    struct ConstantBody : runtime::Executable {
+        runtime::ObjectHolder Execute(runtime::Closure& closure,
+                                      runtime::Context& /*context*/) override {
+            return closure.at("arg"s);
+        }
+    };
+
+    vector<runtime::Method> methods;
+    methods.push_back({"echo"s, {"arg"s}, make_unique<ConstantBody>()});
+    runtime::Class cls("Echo"s, std::move(methods), nullptr);
+
+    vector<unique_ptr<ast::Statement>> args;
+    args.push_back(make_unique<ast::NumericConst>(42));
+    ast::Compound program(
+        make_unique<ast::Assignment>("e"s, make_unique<ast::NewInstance>(cls)),
+        make_unique<ast::Print>(make_unique<ast::MethodCall>(
+            make_unique<ast::VariableValue>("e"s), "echo"s, std::move(args))));
+
+    runtime::DummyContext context;
+    runtime::Closure closure;
+    RunProgram(program, closure, context, Engine::Bytecode);
+    ASSERT_EQUAL(context.output.str(), "42\n"s);
+}
+
+void TestRuntimeErrors() {
+    ASSERT_THROWS(RunWithEngine("print x\n"s, Engine::Bytecode), runtime_error);
+    ASSERT_THROWS(RunWithEngine("print 1 + 'a'\n"s, Engine::Bytecode), runtime_error);
+    ASSERT_THROWS(RunWithEngine("print 1 / 0\n"s, Engine::Bytecode), runtime_error);
+    ASSERT_THROWS(RunWithEngine("x = None\nprint not x\n"s, Engine::Bytecode), runtime_error);
+
+    ASSERT_THROWS(RunWithEngine("print x\n"s, Engine::Flat), runtime_error);
+    ASSERT_THROWS(RunWithEngine("print 1 + 'a'\n"s, Engine::Flat), runtime_error);
+    ASSERT_THROWS(RunWithEngine("print 1 / 0\n"s, Engine::Flat), runtime_error);
+    ASSERT_THROWS(RunWithEngine("x = None\nprint not x\n"s, Engine::Flat), runtime_error);
+}
+
+}  // namespace
+
+void RunVmTests(TestRunner& tr) {
+    RUN_TEST(tr, bytecode::TestCompileExpression);
+    RUN_TEST(tr, bytecode::TestVariablesAndPrint);
+    RUN_TEST(tr, bytecode::TestConditionsAndLogic);
+    RUN_TEST(tr, bytecode::TestClassesAndMethods);
+    RUN_TEST(tr, bytecode::TestRecursionAndReturn);
+    RUN_TEST(tr, bytecode::TestUserDefinedOperators);
+    RUN_TEST(tr, bytecode::TestTreeWalkingFallback);
+    RUN_TEST(tr, bytecode::TestRuntimeErrors);
+}
+
+}  // namespace bytecode